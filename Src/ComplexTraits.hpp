@@ -47,6 +47,61 @@ struct extract_value_type<X<T, Args...>>   //specialization
   typedef T value_type;
 };
 
+/*
+  Type in which the moments and the dot products are accumulated. The vectors of single precision
+  are only stored in single precision: their sums over the lattice are carried in double precision.
+*/
+template<typename T>
+struct accumulator_type
+{
+  typedef T type;
+};
+
+template<>
+struct accumulator_type<float>
+{
+  typedef double type;
+};
+
+template<>
+struct accumulator_type<std::complex<float>>
+{
+  typedef std::complex<double> type;
+};
+
+/*
+  Compensated summation: sum + x is computed exactly as the rounded sum plus its rounding error
+  (Knuth's TwoSum), and the error is kept apart in err. Adding err to sum once all the terms have
+  been added gives the result of a sum carried with twice the precision of T (double-double for
+  double), without a branch and with only additions, so the compiler cannot contract it.
+*/
+template <typename T>
+inline void compensated_add(T & sum, T & err, const T x)
+{
+  const T t  = sum + x;
+  const T xp = t - sum;
+  err += (sum - (t - xp)) + (x - xp);
+  sum = t;
+}
+
+template <typename T>
+inline void compensated_add(std::complex<T> & sum, std::complex<T> & err, const std::complex<T> x)
+{
+  T s[2] = {sum.real(), sum.imag()}, e[2] = {err.real(), err.imag()};
+  compensated_add(s[0], e[0], x.real());
+  compensated_add(s[1], e[1], x.imag());
+  sum = std::complex<T>(s[0], s[1]);
+  err = std::complex<T>(e[0], e[1]);
+}
+
+// Element by element compensated_add of arrays of the same type and size (Eigen arrays or matrices)
+template <typename M>
+inline void compensated_add_all(M & sum, M & err, const M & x)
+{
+  for(decltype(sum.size()) k = 0; k < sum.size(); k++)
+    compensated_add(sum(k), err(k), x(k));
+}
+
 template <typename T>
 class ComplexTraits {
 public:
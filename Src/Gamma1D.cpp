@@ -31,13 +31,23 @@ void Simulation<T,D>::Gamma1D(int NRandomV, int NDisorder, int N_moments,
     num_velocities += indices.at(i).size();
   int factor = 1 - (num_velocities % 2)*2;
     
+  // The random vectors are iterated in blocks of NBlock vectors, interleaved site by site
+  const int NBlock = std::min(int(r.NRandomBlock), NRandomV);
+
   // Initialize the KPM vectors that will be needed to run the 1D Gamma matrix
-  KPM_Vector<T,D> kpm0(1, *this);
-  KPM_Vector<T,D> kpm1(2, *this);
+  KPM_Vector<T,D> kpm0(1, *this, NBlock);
+  KPM_Vector<T,D> kpm1(2, *this, NBlock);
 		
-  // Make sure the local gamma matrix is zeroed
-  Eigen::Array<T, -1, -1> gamma = Eigen::Array<T, -1, -1 >::Zero(1, N_moments);
-  Eigen::Matrix<T, 1, 2> tmp =  Eigen::Matrix < T, 1, 2> ::Zero();		
+  // Make sure the local gamma matrix is zeroed. The moments are accumulated in the accumulator
+  // type, which is double precision when the vectors are stored in single precision
+  typedef typename extract_value_type<accumulator>::value_type accumulator_value;
+  Eigen::Array<accumulator, -1, -1> gamma = Eigen::Array<accumulator, -1, -1 >::Zero(1, N_moments);
+  Eigen::Matrix<accumulator, -1, 2> tmp =  Eigen::Matrix < accumulator, -1, 2> ::Zero(NBlock, 2);		
+  Eigen::Matrix<accumulator, -1, 2> mu01 = Eigen::Matrix < accumulator, -1, 2> ::Zero(NBlock, 2);
+
+  // Only kpm1 is iterated with the Hamiltonian, and the products taken by Multiply ignore its
+  // ghosts, so its boundaries are exchanged once every few multiplications
+  kpm1.defer_exchange(true);
 
   long average = 0;
   for(int disorder = 0; disorder < NDisorder; disorder++){
@@ -47,44 +57,68 @@ void Simulation<T,D>::Gamma1D(int NRandomV, int NDisorder, int N_moments,
       h.build_velocity(indices.at(it), it);
     }
 
-    for(int randV = 0; randV < NRandomV; randV++){
+    for(int randV = 0; randV < NRandomV; randV += NBlock){
+      const int NVec = std::min(NBlock, NRandomV - randV);
         
-      kpm0.initiate_vector();			// original random vector
+      kpm0.initiate_vector(NVec);			// original random vectors
       kpm1.set_index(0);
       kpm1.v.col(0) = kpm0.v.col(0);
       kpm1.Exchange_Boundaries();
 
+      if(num_velocities == 0){
+        // Since bra and ket coincide, the product identities T_n T_n = (T_2n + T_0)/2 and
+        // T_n T_n+1 = (T_2n+1 + T_1)/2 give
+        //   mu(2n)   = 2<phi_n|phi_n>   - mu(0)
+        //   mu(2n+1) = 2<phi_n|phi_n+1> - mu(1)
+        // so each multiplication by the Hamiltonian yields two moments. Multiply takes both
+        // products with phi_n over the interior of the domain while computing phi_n+1
+        for(int m = 0; m < N_moments; m += 2){
+          if(m == 0)
+            kpm1.template Multiply<0>(nullptr, tmp);
+          else
+            kpm1.template Multiply<1>(nullptr, tmp);
+
+          if(m == 0)
+            mu01 = tmp;
+          else
+            tmp = accumulator_value(2)*tmp - mu01;
+
+          for(int ib = 0; ib < NVec; ib++)
+            gamma.matrix().block(0, m,1,2) += (tmp.row(ib) - gamma.matrix().block(0,m,1,2))/accumulator_value(average + ib + 1);
+        }
+
+        average += NVec;
+        continue;
+      }
+
       if(indices.size() != 0)
         generalized_velocity(&kpm1, &kpm0, indices, 0);
 
       kpm0.v.col(0) = factor*kpm0.v.col(0); // This factor is due to the fact that this Velocity operator is not self-adjoint
-      kpm0.empty_ghosts(0);
 
-			
-      kpm1.template Multiply<0>();		
-      tmp.setZero();
-      for(std::size_t ii = 0; ii < r.Sized ; ii += r.Ld[0])
-        tmp += kpm0.v.block(ii,0, r.Ld[0], 1).adjoint() * kpm1.v.block(ii, 0, r.Ld[0], 2);
+      // The products <0|v T_n> are taken by Multiply over the interior, so the ghosts of kpm0 need not be emptied
+      kpm1.template Multiply<0>(kpm0.v.data(), tmp);
 
-      gamma.matrix().block(0,0,1,2) += (tmp - gamma.matrix().block(0,0,1,2))/value_type(average + 1);			
+      for(int ib = 0; ib < NVec; ib++)
+        gamma.matrix().block(0,0,1,2) += (tmp.row(ib) - gamma.matrix().block(0,0,1,2))/accumulator_value(average + ib + 1);			
 	
       for(int m = 2; m < N_moments; m += 2){
         kpm1.template Multiply<1>();
-        kpm1.template Multiply<1>();
-        tmp.setZero();
-        for(std::size_t ii = 0; ii < r.Sized ; ii += r.Ld[0])
-          tmp += kpm0.v.block(ii,0, r.Ld[0], 1).adjoint() * kpm1.v.block(ii, 0, r.Ld[0], 2);
+        kpm1.template Multiply<1>(kpm0.v.data(), tmp);
 
-        gamma.matrix().block(0, m,1,2) += (tmp - gamma.matrix().block(0,m,1,2))/value_type(average + 1);
+        for(int ib = 0; ib < NVec; ib++)
+          gamma.matrix().block(0, m,1,2) += (tmp.row(ib) - gamma.matrix().block(0,m,1,2))/accumulator_value(average + ib + 1);
 
       }
   //std::cout << "got to line " << __LINE__ << " in file " << __FILE__ << "\n" << std::flush;
 
-      average++;
+      average += NVec;
     }
   } 
+  kpm1.defer_exchange(false);
 
-  store_gamma1D(&gamma, name_dataset);
+  Eigen::Array<T, -1, -1> gamma_T = gamma.template cast<T>();
+  store_gamma1D(&gamma_T, name_dataset);
 }
 
 
@@ -97,13 +131,7 @@ void Simulation<T,D>::store_gamma1D(Eigen::Array<T, -1, -1> *gamma,
 
 
 
-  long int size_gamma = gamma->cols();
-#pragma omp master
-  Global.general_gamma = Eigen::Array<T, -1, -1 > :: Zero(1, size_gamma);
-#pragma omp barrier
-#pragma omp critical
-  Global.general_gamma += *gamma;
-#pragma omp barrier
+  Global.reduce(Global.general_gamma, *gamma);
 
     
 #pragma omp master
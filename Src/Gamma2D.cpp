@@ -22,12 +22,14 @@ class KPM_Vector;
 #include "Hamiltonian.hpp"
 #include "KPM_VectorBasis.hpp"
 #include "KPM_Vector.hpp"
+#include "VectorBank.hpp"
 
 
 template <typename T,unsigned D>
 void Simulation<T,D>::Gamma2D(int NRandomV, int NDisorder, std::vector<int> N_moments, 
                               std::vector<std::vector<unsigned>> indices, std::string name_dataset){
-  Eigen::Matrix<T, MEMORY, MEMORY> tmp;
+  Eigen::Matrix<accumulator, -1, -1> tmp, tmp_err, row;
+  Eigen::Array<accumulator, -1, -1> slab;   // Moments of this thread for a block of n and all m
   // This function calculates all kinds of two-dimensional gamma matrices such
   // as Tr[V^a Tn v^b Tm] = G_nm
   //
@@ -48,113 +50,155 @@ void Simulation<T,D>::Gamma2D(int NRandomV, int NDisorder, std::vector<int> N_mo
   // This function calculates all the kinds of one-dimensional Gamma matrices
   // such as Tr[Tn]    Tr[v^xx Tn]     etc
 
-  typedef typename extract_value_type<T>::value_type value_type;
-
-  int num_velocities = 0;
-  for(int i = 0; i < int(indices.size()); i++)
-    num_velocities += indices.at(i).size();
-  int factor = 1 - (num_velocities % 2)*2;
+  // The products of each row and the moments are accumulated in the accumulator type,
+  // which is double precision when the vectors are stored in single precision. The sums
+  // over the rows are compensated (see compensated_add)
+  typedef typename extract_value_type<accumulator>::value_type accumulator_value;
 
   //  --------- INITIALIZATIONS --------------
+
+  // The random vectors are iterated in blocks of NBlock vectors, interleaved site by site
+  const int NBlock = std::min(int(r.NRandomBlock), NRandomV);
+
+  // The moments are computed in blocks of NMemory x NMemory; the last blocks may be smaller
+  const int NMemory = memory_block(std::max(N_moments.at(0), N_moments.at(1)), NBlock);
+
+  // The right vectors are iterated again for every block of left vectors, unless they are
+  // computed once and kept in a bank (/VectorBank), which takes N_moments(1) vectors of storage
+  const bool use_bank = r.bank != 0 && N_moments.at(0) > NMemory;
+  VectorBank<T> bank(use_bank ? r.Sized * NBlock : 0, use_bank ? N_moments.at(1) : 0, NBlock, use_bank && r.bank == 2);
     
-  KPM_Vector<T,D> kpm0(1, *this);      // initial random vector
-  KPM_Vector<T,D> kpm1(2, *this); // left vector that will be Chebyshev-iterated on
-  KPM_Vector<T,D> kpm2(MEMORY, *this); // right vector that will be Chebyshev-iterated on
-  KPM_Vector<T,D> kpm3(MEMORY, *this); // kpm1 multiplied by the velocity
+  KPM_Vector<T,D> kpm0(1, *this, NBlock);      // initial random vector
+  KPM_Vector<T,D> kpm1(2, *this, NBlock); // left vector that will be Chebyshev-iterated on
+  KPM_Vector<T,D> kpm2(use_bank ? 2 : NMemory, *this, NBlock); // right vector that will be Chebyshev-iterated on
+  KPM_Vector<T,D> kpm3(NMemory, *this, NBlock); // kpm1 multiplied by the velocity
 
-  // initialize the local gamma matrix and set it to 0
-  int size_gamma = 1;
   for(int i = 0; i < 2; i++){
     if(N_moments.at(i) % 2 != 0){
       std::cout << "The number of moments must be an even number, due to limitations of the program. Aborting\n";
       exit(1);
     }
-    size_gamma *= N_moments.at(i);
   }
 
-  Eigen::Array<T, -1, -1> gamma = Eigen::Array<T, -1, -1 >::Zero(1, size_gamma);
+  // The gamma matrix is shared by all the threads. Each thread only keeps the moments of its
+  // own domain for the current block of left vectors, which are summed over the threads once
+  // the whole block of rows is computed
+#pragma omp master
+  Global.shared_gamma = Eigen::Array<accumulator, -1, -1>::Zero(N_moments.at(0), N_moments.at(1));
+#pragma omp barrier
  
   // finished initializations
 
 
     
     
+  // kpm2 only enters the dot products against kpm3, whose ghosts are emptied, so its
+  // boundaries are exchanged once every few multiplications. kpm1 feeds the velocity
+  // and needs up-to-date ghosts after every step
+  kpm2.defer_exchange(true);
+
   // start the kpm iteration
   long average = 0;
   for(int disorder = 0; disorder < NDisorder; disorder++){
     h.generate_disorder();
     for(unsigned it = 0; it < indices.size(); it++)
       h.build_velocity(indices.at(it), it);
-    for(int randV = 0; randV < NRandomV; randV++){
+    for(int randV = 0; randV < NRandomV; randV += NBlock){
+      const int NVec = std::min(NBlock, NRandomV - randV);
         
 
-      kpm0.initiate_vector();			// original random vector. This sets the index to zero
+      kpm0.initiate_vector(NVec);			// original random vectors. This sets the index to zero
       kpm0.Exchange_Boundaries();
       kpm1.set_index(0);
 
       generalized_velocity(&kpm1, &kpm0, indices, 0);
+
+      // fill the bank with the right vectors
+      if(use_bank){
+        kpm2.set_index(0);
+        kpm2.v.col(0) = kpm0.v.col(0);
+        for(int m = 0; m < N_moments.at(1); m++){
+          if(m != 0)
+            cheb_iteration(&kpm2, m-1);
+          std::copy(kpm2.v.col(kpm2.get_index()).data(), kpm2.v.col(kpm2.get_index()).data() + kpm2.v.rows(), bank.col(m));
+        }
+      }
         
-      // run through the left loop MEMORY iterations at a time
-      for(int n = 0; n < N_moments.at(0); n+=MEMORY){
+      // run through the left loop NMemory iterations at a time
+      for(int n = 0; n < N_moments.at(0); n+=NMemory){
+        const int bn = std::min(NMemory, N_moments.at(0) - n);
           
-        // Iterate MEMORY times. The first time this occurs, we must exclude the zeroth
+        // Iterate bn times. The first time this occurs, we must exclude the zeroth
         // case, because it is already calculated, it's the identity
-        for(int i = n; i < n + MEMORY; i++){
+        for(int i = n; i < n + bn; i++){
           if(i!=0){
             cheb_iteration(&kpm1, i-1);
           }
 
-          kpm3.set_index(i%MEMORY);
+          kpm3.set_index(i%NMemory);
           generalized_velocity(&kpm3, &kpm1, indices, 1);
-          kpm3.empty_ghosts(i%MEMORY);
+          kpm3.empty_ghosts(i%NMemory);
         }
           
         // copy the |0> vector to |kpm2>
-        kpm2.set_index(0);
-        kpm2.v.col(0) = kpm0.v.col(0);
-        for(int m = 0; m < N_moments.at(1); m+=MEMORY){
+        if(!use_bank){
+          kpm2.set_index(0);
+          kpm2.v.col(0) = kpm0.v.col(0);
+        }
+        slab.setZero(bn, N_moments.at(1));
+        for(int m = 0; m < N_moments.at(1); m+=NMemory){
+          const int bm = std::min(NMemory, N_moments.at(1) - m);
 
-          // iterate MEMORY times, just like before. No need to multiply by v here
-          for(int i = m; i < m + MEMORY; i++){
+          // iterate bm times, just like before. No need to multiply by v here
+          for(int i = m; i < m + bm && !use_bank; i++){
             if(i!=0){
               cheb_iteration(&kpm2, i-1);
             }
           }
           //std::cout << "index2: " << kpm2.get_index() << "\n";
-          // Finally, do the matrix product and store the result in the Gamma matrix
-          tmp.setZero();
-          for(std::size_t ii = 0; ii < r.Sized ; ii += r.Ld[0])
-            tmp += kpm3.v.block(ii,0, r.Ld[0], MEMORY).adjoint() * kpm2.v.block(ii, 0, r.Ld[0], MEMORY);
-          T flatten;
-          long int ind;
-          for(int j = 0; j < MEMORY; j++)
-            for(int i = 0; i < MEMORY; i++){
-              flatten = tmp(i,j);
-              ind = (m+j)*N_moments.at(0) + n+i;
-              gamma(ind) += (flatten - gamma(ind))/value_type(average + 1);			
+          // Finally, do the matrix product, summed over the NVec random vectors
+          tmp.setZero(bn, bm);
+          tmp_err.setZero(bn, bm);
+          for(int ib = 0; ib < NVec; ib++)
+            for(std::size_t ii = 0; ii < r.Sized ; ii += r.Ld[0]){
+              row = (kpm3.block_vector(ib, ii, r.Ld[0], 0, bn).adjoint() *
+                     (use_bank ? bank.block_vector(ib, ii, r.Ld[0], m, bm) : kpm2.block_vector(ib, ii, r.Ld[0], 0, bm))).template cast<accumulator>();
+              compensated_add_all(tmp, tmp_err, row);
             }
+          tmp += tmp_err;
+          slab.block(0, m, bn, bm) = tmp.array();
         }
+
+        // Sum of the slabs of the threads. Each thread averages its own slice of the sums into
+        // the shared gamma, so this is the only synchronisation of the block of left vectors
+        Global.reduce_slices(slab.data(), std::size_t(slab.size()), [&](std::size_t k, accumulator sum){
+            accumulator & g = Global.shared_gamma(n + k % bn, k / bn);
+            g += (sum - accumulator_value(NVec)*g)/accumulator_value(average + NVec);
+          });
       }
-      average++;
+      average += NVec;
     }
   } 
-  gamma = gamma*factor;
+  kpm2.defer_exchange(false);
+  slab.resize(0, 0);
             
-  store_gamma(&gamma, N_moments, indices, name_dataset);
+  store_gamma(N_moments, indices, name_dataset, NMemory);
 }
 
 
 
 
 template <typename T,unsigned D>
-void Simulation<T,D>::store_gamma(Eigen::Array<T, -1, -1> *gamma, std::vector<int> N_moments, 
-                                  std::vector<std::vector<unsigned>> indices, std::string name_dataset){
+void Simulation<T,D>::store_gamma(std::vector<int> N_moments, std::vector<std::vector<unsigned>> indices,
+                                  std::string name_dataset, int NColumns){
   debug_message("Entered store_gamma\n");
-  // The whole purpose of this function is to take the Gamma matrix calculated by
-
-
+  // The whole purpose of this function is to take the Gamma matrix accumulated by all the
+  // threads in Global.shared_gamma and write it to the output file. It is written NColumns
+  // columns at a time, so that no full copy of the matrix is ever made
+  typedef typename extract_value_type<accumulator>::value_type accumulator_value;
 
-  long int size_gamma = gamma->cols();
+  const Eigen::Array<accumulator, -1, -1> & gamma = Global.shared_gamma;
+  long int size_gamma = gamma.size();
   int dim = indices.size();
 
 		
@@ -166,40 +210,33 @@ void Simulation<T,D>::store_gamma(Eigen::Array<T, -1, -1> *gamma, std::vector<in
   for(int i = 0; i < int(indices.size()); i++)
     num_velocities += indices.at(i).size();
   int factor = 1 - (num_velocities % 2)*2;
-		
-  switch(dim){
-  case 2: {
-    Eigen::Array<T,-1,-1> general_gamma = Eigen::Map<Eigen::Array<T,-1,-1>>(gamma->data(), N_moments.at(0), N_moments.at(1));
-#pragma omp master
-    Global.general_gamma = Eigen::Array<T, -1, -1 > :: Zero(N_moments.at(0), N_moments.at(1));
-#pragma omp barrier
-#pragma omp critical
-    Global.general_gamma.matrix() += (general_gamma.matrix() + factor*general_gamma.matrix().adjoint())/2.0;
-#pragma omp barrier
-    break;
-  }
-  case 1: {
-    Eigen::Array<T,-1,-1> general_gamma = Eigen::Map<Eigen::Array<T,-1,-1>>(gamma->data(), 1, size_gamma);
-#pragma omp master
-    Global.general_gamma = Eigen::Array<T, -1, -1 > :: Zero(1, size_gamma);
-#pragma omp barrier
-#pragma omp critical
-    Global.general_gamma += general_gamma;
-#pragma omp barrier
-    break;
-  }
-  default:
+
+  if(dim != 1 && dim != 2){
     std::cout << "You're trying to store a matrix that is not expected by the program. Exiting.\n";
     exit(1);
   }
     
-
-    
 #pragma omp master
   {
     H5::H5File * file = new H5::H5File(name, H5F_ACC_RDWR);
-    write_hdf5(Global.general_gamma, file, name_dataset);
+    Eigen::Array<T, -1, -1> columns;
+    if(dim == 2){
+      // symmetrized matrix, column by column
+      for(int j = 0; j < N_moments.at(1); j += NColumns){
+        const int bj = std::min(NColumns, N_moments.at(1) - j);
+        columns = ((gamma.block(0, j, N_moments.at(0), bj).matrix() + accumulator_value(factor)*gamma.block(j, 0, bj, N_moments.at(1)).matrix().adjoint())
+                   *accumulator_value(factor)/accumulator_value(2)).array().template cast<T>();
+        write_hdf5_columns(columns, file, name_dataset, N_moments.at(1), j);
+      }
+    } else {
+      for(long int j = 0; j < size_gamma; j += NColumns){
+        const long int bj = std::min(long(NColumns), size_gamma - j);
+        columns = (Eigen::Map<const Eigen::Array<accumulator, 1, -1>>(gamma.data() + j, bj)*accumulator_value(factor)).template cast<T>();
+        write_hdf5_columns(columns, file, name_dataset, size_gamma, j);
+      }
+    }
     delete file;
+    Global.shared_gamma.resize(0, 0);
   }
 #pragma omp barrier    
 
@@ -234,23 +271,23 @@ template void Simulation<std::complex<long double> ,2u>::Gamma2D(int, int, std::
 //void Simulation<T,D>::store_gamma3D(Eigen::Array<T, -1, -1> *gamma, std::vector<int> N_moments, 
                                     //std::vector<std::vector<unsigned>> indices, std::string name_dataset){
 
-template void Simulation<float ,1u>::store_gamma(Eigen::Array<float, -1, -1>* , std::vector<int>, std::vector<std::vector<unsigned>>, std::string);
-template void Simulation<double ,1u>::store_gamma(Eigen::Array<double, -1, -1>* , std::vector<int>, std::vector<std::vector<unsigned>>, std::string);
-template void Simulation<long double ,1u>::store_gamma(Eigen::Array<long double, -1, -1>* , std::vector<int>, std::vector<std::vector<unsigned>>, std::string);
-template void Simulation<std::complex<float> ,1u>::store_gamma(Eigen::Array<std::complex<float>, -1, -1>* , std::vector<int>, std::vector<std::vector<unsigned>>, std::string);
-template void Simulation<std::complex<double> ,1u>::store_gamma(Eigen::Array<std::complex<double>, -1, -1>* , std::vector<int>, std::vector<std::vector<unsigned>>, std::string);
-template void Simulation<std::complex<long double> ,1u>::store_gamma(Eigen::Array<std::complex<long double>, -1, -1>* , std::vector<int>, std::vector<std::vector<unsigned>>, std::string);
-
-template void Simulation<float ,2u>::store_gamma(Eigen::Array<float, -1, -1>* , std::vector<int>, std::vector<std::vector<unsigned>>, std::string);
-template void Simulation<double ,2u>::store_gamma(Eigen::Array<double, -1, -1>* , std::vector<int>, std::vector<std::vector<unsigned>>, std::string);
-template void Simulation<long double ,2u>::store_gamma(Eigen::Array<long double, -1, -1>* , std::vector<int>, std::vector<std::vector<unsigned>>, std::string);
-template void Simulation<std::complex<float> ,2u>::store_gamma(Eigen::Array<std::complex<float>, -1, -1>* , std::vector<int>, std::vector<std::vector<unsigned>>, std::string);
-template void Simulation<std::complex<double> ,2u>::store_gamma(Eigen::Array<std::complex<double>, -1, -1>* , std::vector<int>, std::vector<std::vector<unsigned>>, std::string);
-template void Simulation<std::complex<long double> ,2u>::store_gamma(Eigen::Array<std::complex<long double>, -1, -1>* , std::vector<int>, std::vector<std::vector<unsigned>>, std::string);
-
-template void Simulation<float ,3u>::store_gamma(Eigen::Array<float, -1, -1>* , std::vector<int>, std::vector<std::vector<unsigned>>, std::string);
-template void Simulation<double ,3u>::store_gamma(Eigen::Array<double, -1, -1>* , std::vector<int>, std::vector<std::vector<unsigned>>, std::string);
-template void Simulation<long double ,3u>::store_gamma(Eigen::Array<long double, -1, -1>* , std::vector<int>, std::vector<std::vector<unsigned>>, std::string);
-template void Simulation<std::complex<float> ,3u>::store_gamma(Eigen::Array<std::complex<float>, -1, -1>* , std::vector<int>, std::vector<std::vector<unsigned>>, std::string);
-template void Simulation<std::complex<double> ,3u>::store_gamma(Eigen::Array<std::complex<double>, -1, -1>* , std::vector<int>, std::vector<std::vector<unsigned>>, std::string);
-template void Simulation<std::complex<long double> ,3u>::store_gamma(Eigen::Array<std::complex<long double>, -1, -1>* , std::vector<int>, std::vector<std::vector<unsigned>>, std::string);
+template void Simulation<float ,1u>::store_gamma(std::vector<int>, std::vector<std::vector<unsigned>>, std::string, int);
+template void Simulation<double ,1u>::store_gamma(std::vector<int>, std::vector<std::vector<unsigned>>, std::string, int);
+template void Simulation<long double ,1u>::store_gamma(std::vector<int>, std::vector<std::vector<unsigned>>, std::string, int);
+template void Simulation<std::complex<float> ,1u>::store_gamma(std::vector<int>, std::vector<std::vector<unsigned>>, std::string, int);
+template void Simulation<std::complex<double> ,1u>::store_gamma(std::vector<int>, std::vector<std::vector<unsigned>>, std::string, int);
+template void Simulation<std::complex<long double> ,1u>::store_gamma(std::vector<int>, std::vector<std::vector<unsigned>>, std::string, int);
+
+template void Simulation<float ,2u>::store_gamma(std::vector<int>, std::vector<std::vector<unsigned>>, std::string, int);
+template void Simulation<double ,2u>::store_gamma(std::vector<int>, std::vector<std::vector<unsigned>>, std::string, int);
+template void Simulation<long double ,2u>::store_gamma(std::vector<int>, std::vector<std::vector<unsigned>>, std::string, int);
+template void Simulation<std::complex<float> ,2u>::store_gamma(std::vector<int>, std::vector<std::vector<unsigned>>, std::string, int);
+template void Simulation<std::complex<double> ,2u>::store_gamma(std::vector<int>, std::vector<std::vector<unsigned>>, std::string, int);
+template void Simulation<std::complex<long double> ,2u>::store_gamma(std::vector<int>, std::vector<std::vector<unsigned>>, std::string, int);
+
+template void Simulation<float ,3u>::store_gamma(std::vector<int>, std::vector<std::vector<unsigned>>, std::string, int);
+template void Simulation<double ,3u>::store_gamma(std::vector<int>, std::vector<std::vector<unsigned>>, std::string, int);
+template void Simulation<long double ,3u>::store_gamma(std::vector<int>, std::vector<std::vector<unsigned>>, std::string, int);
+template void Simulation<std::complex<float> ,3u>::store_gamma(std::vector<int>, std::vector<std::vector<unsigned>>, std::string, int);
+template void Simulation<std::complex<double> ,3u>::store_gamma(std::vector<int>, std::vector<std::vector<unsigned>>, std::string, int);
+template void Simulation<std::complex<long double> ,3u>::store_gamma(std::vector<int>, std::vector<std::vector<unsigned>>, std::string, int);
@@ -22,11 +22,13 @@ class KPM_Vector;
 #include "Hamiltonian.hpp"
 #include "KPM_VectorBasis.hpp"
 #include "KPM_Vector.hpp"
+#include "VectorBank.hpp"
 
 template <typename T,unsigned D>
 void Simulation<T,D>::Gamma3D(int NRandomV, int NDisorder, std::vector<int> N_moments, 
                               std::vector<std::vector<unsigned>> indices, std::string name_dataset){
-  Eigen::Matrix<T, MEMORY, MEMORY> tmp;
+  Eigen::Matrix<accumulator, -1, -1> tmp, tmp_err, row;   // Products of a block of moments, see accumulator_type and compensated_add
+  Eigen::Array<accumulator, -1, -1> slab;                    // G_nmp of this thread for a block of n, all m and one p
   // This calculates all the kinds of three-dimensional gamma matrices
   // such as Tr[v^a Tn v^b Tm v^c Tp] = G_nmp. The output is a 2D matrix 
   // organized as follows:
@@ -69,15 +71,27 @@ void Simulation<T,D>::Gamma3D(int NRandomV, int NDisorder, std::vector<int> N_mo
   // in blocks
   //
     
-  typedef typename extract_value_type<T>::value_type value_type;
+  typedef typename extract_value_type<accumulator>::value_type accumulator_value;
     
   //  --------- INITIALIZATIONS --------------
     
+  // The moments n and m are computed in blocks of NMemory x NMemory; the last blocks may be smaller
+  const int NMemory = memory_block(std::max(N_moments.at(0), N_moments.at(1)), 1);
+
+  // The middle and right recursions are repeated for every block of left vectors, which takes
+  // N0*N1*N2/NMemory multiplications. With /VectorBank all the N0 left vectors are computed once
+  // and kept in a bank, so that they make a single block: N1*N2 multiplications, and dense
+  // contractions of the middle vectors against the whole bank
+  const bool use_bank = r.bank != 0 && N_moments.at(0) > NMemory;
+  const int NLeft = (use_bank ? N_moments.at(0) : NMemory);
+  VectorBank<T> bank(use_bank ? r.Sized : 0, use_bank ? N_moments.at(0) : 0, 1, use_bank && r.bank == 2);
+
   KPM_Vector<T,D> kpm0(1, *this);           // initial random vector
   KPM_Vector<T,D> kpm_Vn(2, *this);          // left vector that will be Chebyshev-iterated on
-  KPM_Vector<T,D> kpm_VnV(MEMORY, *this);    // kpmL multiplied by the velocity
+  const int NVnV = (use_bank ? 1 : NMemory);
+  KPM_Vector<T,D> kpm_VnV(NVnV, *this);    // kpmL multiplied by the velocity
   KPM_Vector<T,D> kpm_p(2, *this);          // right-most vector that will be Chebyshev-iterated on
-  KPM_Vector<T,D> kpm_pVm(MEMORY, *this);         // middle vector that will be Chebyshev-iterated on
+  KPM_Vector<T,D> kpm_pVm(NMemory, *this);         // middle vector that will be Chebyshev-iterated on
     
   // initialize the local gamma matrix and set it to 0
   int size_gamma = 1;
@@ -91,7 +105,6 @@ void Simulation<T,D>::Gamma3D(int NRandomV, int NDisorder, std::vector<int> N_mo
 #pragma omp master
   {
     Global.general_gamma = Eigen::Array<T, -1, -1>::Zero(1, size_gamma);
-    Global.smaller_gamma = Eigen::Array<T, -1, -1>::Zero(MEMORY, MEMORY);
   }
 #pragma omp barrier
     
@@ -115,15 +128,18 @@ void Simulation<T,D>::Gamma3D(int NRandomV, int NDisorder, std::vector<int> N_mo
 
       generalized_velocity(&kpm_Vn, &kpm0, indices, 0);
         
-      for(int n = 0; n < N_moments.at(0); n+=MEMORY){
+      for(int n = 0; n < N_moments.at(0); n+=NLeft){
+        const int bn = std::min(NLeft, N_moments.at(0) - n);
 
         // Calculation of the left kpm vector
-        for(int ni = n; ni < n + MEMORY; ni++){
+        for(int ni = n; ni < n + bn; ni++){
           if(ni!=0) cheb_iteration(&kpm_Vn, ni-1);
            
-          kpm_VnV.set_index(ni%MEMORY);
+          kpm_VnV.set_index(ni%NVnV);
           generalized_velocity(&kpm_VnV, &kpm_Vn, indices, 1);
-          kpm_VnV.empty_ghosts(ni%MEMORY);
+          kpm_VnV.empty_ghosts(ni%NVnV);
+          if(use_bank)
+            std::copy(kpm_VnV.v.col(0).data(), kpm_VnV.v.col(0).data() + r.Sized, bank.col(ni));
         }
           
         // Calculation of the right kpm vector
@@ -134,35 +150,38 @@ void Simulation<T,D>::Gamma3D(int NRandomV, int NDisorder, std::vector<int> N_mo
             
           kpm_pVm.set_index(0);
           generalized_velocity(&kpm_pVm, &kpm_p, indices, 2);
-          for(int m = 0; m < N_moments.at(1); m += MEMORY){
-            for(int mi = m; mi < m + MEMORY; mi++)
+
+          // Each thread fills its own slab of moments, which is summed over the threads only
+          // once all the m have been computed
+          slab.setZero(NLeft, N_moments.at(1));
+          for(int m = 0; m < N_moments.at(1); m += NMemory){
+            const int bm = std::min(NMemory, N_moments.at(1) - m);
+            for(int mi = m; mi < m + bm; mi++)
               if(mi != 0) cheb_iteration(&kpm_pVm, mi-1);
 
-            tmp.setZero();
-            for(std::size_t ii = 0; ii < r.Sized ; ii += r.Ld[0])
-              tmp += kpm_VnV.v.block(ii,0, r.Ld[0], MEMORY).adjoint() * kpm_pVm.v.block(ii, 0, r.Ld[0], MEMORY);
-              
-#pragma omp master
-            {
-              Global.smaller_gamma.setZero();
-            }
-#pragma omp barrier
-#pragma omp critical
-            {
-              Global.smaller_gamma += tmp.array();
+            tmp.setZero(bn, bm);
+            tmp_err.setZero(bn, bm);
+            for(std::size_t ii = 0; ii < r.Sized ; ii += r.Ld[0]){
+              row = ((use_bank ? bank.block_vector(0, ii, r.Ld[0], 0, bn) : kpm_VnV.block_vector(0, ii, r.Ld[0], 0, bn)).adjoint() *
+                     kpm_pVm.v.block(ii, 0, r.Ld[0], bm)).template cast<accumulator>();
+              compensated_add_all(tmp, tmp_err, row);
             }
-#pragma omp barrier
-#pragma omp master
-            {
-              long int index;
-              for(int i = 0; i < MEMORY; i++)
-                for(int j = 0; j < MEMORY; j++){
-                  index = p*N_moments.at(1)*N_moments.at(0) + (m+j)*N_moments.at(0) + n+i;
-                  Global.general_gamma(index) += (Global.smaller_gamma(i, j) - Global.general_gamma(index))/value_type(average + 1);
-                }
-            }
-#pragma omp barrier
+            tmp += tmp_err;
+            slab.block(0, m, bn, bm) = tmp.array();
           }
+
+          // Sum of the slabs of the threads, in the accumulator type. Each thread averages its own
+          // slice of the sums into general_gamma, so the reduction is the only synchronisation of
+          // the right moment. The moments are only rounded to T when they are stored
+          const std::size_t rows = slab.rows();
+          Global.reduce_slices(slab.data(), std::size_t(slab.size()), [&](std::size_t k, accumulator sum){
+              const std::size_t i = k % rows, j = k / rows;
+              if(i < std::size_t(bn)){
+                const long int index = p*N_moments.at(1)*N_moments.at(0) + j*N_moments.at(0) + n+i;
+                const accumulator g = accumulator(Global.general_gamma(index));
+                Global.general_gamma(index) = T(g + (sum - g)/accumulator_value(average + 1));
+              }
+            });
         }
       }
       average++;
@@ -15,6 +15,7 @@
 #include <complex>
 #include <random>
 #include <vector>
+#include <map>
 #include <iostream>
 #include <fstream>
 #include <algorithm>
@@ -29,9 +30,10 @@
 #include <initializer_list>
 
 // Set of compilation parameters chosen in the Makefile
-// MEMORY is the number of KPM vectors stored in the memory while calculating Gamma2D
-// TILE is the size of the memory blocks used in the program
+// MEMORY is the default number of KPM vectors stored in the memory while calculating Gamma2D and Gamma3D (set at run time with /Memory)
+// TILE is the default size of the memory blocks used in the program (set at run time with /Tile)
 // COMPILE_MAIN is a flag to prevent compilation of unnecessary parts of the code when testing
+// SIMD_KERNELS enables the hand vectorized complex stencils, chosen at run time for the available CPU
 #ifndef MEMORY
 #define MEMORY 16
 #endif
@@ -40,6 +42,10 @@
 #define TILE 64
 #endif
 
+#ifndef SIMD_KERNELS
+#define SIMD_KERNELS 1
+#endif
+
 #ifndef DEBUG
 #define DEBUG 0
 #endif
@@ -59,7 +65,11 @@
 // other compilation parameters not set in the Makefile
 // NGHOSTS is the extra length in each direction, to be used with the blocks of size TILE
 #define PATTERNS  4
+// Wider ghost layers let Multiply advance more steps between exchanges (see KPM_Vector::defer_exchange)
+#ifndef NGHOSTS
 #define NGHOSTS   2
+#endif
+#define STENCIL_BLOCK 8   // Number of elements of a tile row kept in registers by the stencil
 #define VVERBOSE 0
 #define SSPRINT 0
 
@@ -5,10 +5,24 @@
 /*                                                         */
 /***********************************************************/
 
-#include <vector>
-#include <Eigen/Dense>
+#include "Generic.hpp"
+#include "ComplexTraits.hpp"
 #include "Global.hpp"
 
+namespace {
+  // Waits until a sequence number written by another thread reaches value
+  void wait_sequence(unsigned long & sequence, unsigned long value) {
+    unsigned long seen;
+    while(true){
+#pragma omp atomic read seq_cst
+      seen = sequence;
+      if(seen >= value)
+        break;
+      std::this_thread::yield();
+    }
+  }
+}
+
 template <typename T>
 GLOBAL_VARIABLES<T>::GLOBAL_VARIABLES() { }
 
@@ -25,6 +39,58 @@ void GLOBAL_VARIABLES<T>::addlocal( std::size_t  ele,  T u ) {
   U.push_back(u);
 }
 
+/*
+  Sum of the arrays part of all the threads, left in sum. It must be called by all the threads of
+  the parallel region, with arrays of the same size. Instead of adding the arrays one thread at a
+  time, each thread sums a slice of the elements over all the threads (see reduce_slices), so the
+  time of the sum does not grow with the number of threads and the result does not depend on the
+  scheduling.
+*/
+template <typename T>
+void GLOBAL_VARIABLES<T>::reduce(Eigen::Array<T, -1, -1> & sum, const Eigen::Array<T, -1, -1> & part) {
+#pragma omp master
+  sum.resize(part.rows(), part.cols());
+  reduce_slices(part.data(), part.size(), [&sum](std::size_t k, T x){ sum(k) = x; });
+}
+
+/*
+  Point to point exchange of the ghosts. Every thread owns one slot of Global.ghosts per direction,
+  whose left and right halves hold the edges read by its left and right neighbours. A thread
+    - gets its slot with send_ghosts, which waits until the neighbours given by edges have read
+      the previous contents, packs its edges in it and publishes them with sent_ghosts,
+    - gets the slot of each neighbour with receive_ghosts, which waits until the neighbour has
+      published the same exchange, copies the half it needs and releases it with received_ghosts.
+  All the threads exchange the same sequence of edges, so the number of edges published by a
+  slot identifies the exchange, and each thread only ever waits for its own neighbours.
+*/
+template <typename T>
+T * GLOBAL_VARIABLES<T>::send_ghosts(std::size_t slot, const bool * edges) {
+  for(unsigned edge = 0; edge < 2; edge++)
+    if(edges[edge])
+      wait_sequence(ghosts_read[2 * slot + edge], ghosts_ready[slot]);
+  return ghosts.data() + slot * (ghosts.size() / ghosts_ready.size());
+}
+
+template <typename T>
+void GLOBAL_VARIABLES<T>::sent_ghosts(std::size_t slot) {
+  const unsigned long sequence = ghosts_ready[slot] + 1;
+#pragma omp atomic write seq_cst
+  ghosts_ready[slot] = sequence;
+}
+
+template <typename T>
+const T * GLOBAL_VARIABLES<T>::receive_ghosts(std::size_t slot, std::size_t from) {
+  wait_sequence(ghosts_ready[from], ghosts_ready[slot]);
+  return ghosts.data() + from * (ghosts.size() / ghosts_ready.size());
+}
+
+template <typename T>
+void GLOBAL_VARIABLES<T>::received_ghosts(std::size_t slot, std::size_t from, unsigned edge) {
+  const unsigned long sequence = ghosts_ready[slot];
+#pragma omp atomic write seq_cst
+  ghosts_read[2 * from + edge] = sequence;
+}
+
 template struct GLOBAL_VARIABLES<float>;
 template struct GLOBAL_VARIABLES<double>;
 template struct GLOBAL_VARIABLES<long double>;
@@ -7,7 +7,9 @@
 
 template <typename T>
 struct GLOBAL_VARIABLES {
-  std::vector<T> ghosts;
+  std::vector<T> ghosts;                     // One slot of edges per thread and direction (see send_ghosts)
+  std::vector<unsigned long> ghosts_ready;   // Edges published in each slot
+  std::vector<unsigned long> ghosts_read;    // Edges read from each slot, for its left and right halves
   std::vector<std::size_t>    element1;
   std::vector<std::ptrdiff_t> element2_diff;
   std::vector<T> hopping;
@@ -21,13 +23,13 @@ struct GLOBAL_VARIABLES {
   Eigen::Array <T, Eigen::Dynamic, Eigen::Dynamic> lambda;
   Eigen::Array <T, Eigen::Dynamic, Eigen::Dynamic> singleshot_cond;
   Eigen::Array <T, Eigen::Dynamic, Eigen::Dynamic> general_gamma;
-  Eigen::Array <T, Eigen::Dynamic, Eigen::Dynamic> smaller_gamma;
+  Eigen::Array <typename accumulator_type<T>::type, Eigen::Dynamic, Eigen::Dynamic> shared_gamma;   // Moments of Gamma2D, shared by the threads
   Eigen::Array <T, Eigen::Dynamic, Eigen::Dynamic> avg_x;
   Eigen::Array <T, Eigen::Dynamic, Eigen::Dynamic> avg_y;
   Eigen::Array <T, Eigen::Dynamic, Eigen::Dynamic> avg_z;
   Eigen::Array <T, Eigen::Dynamic, Eigen::Dynamic> avg_ident;
   Eigen::Array <T, Eigen::Dynamic, Eigen::Dynamic> avg_results;
-  double kpm_iteration_time;
+  double kpm_iteration_time;   // Slowest time of a Chebyshev iteration over the threads (see tune_tile)
   
   bool calculate_arpes;
   bool calculate_ldos;
@@ -38,7 +40,43 @@ struct GLOBAL_VARIABLES {
   bool calculate_condopt2;
   bool calculate_singleshot;
 
+  std::vector<const void *> reduce_parts;   // Arrays of the threads being summed by reduce_slices
+
   GLOBAL_VARIABLES();
   void addbond ( std::size_t, std::ptrdiff_t, T );
   void addlocal( std::size_t,  T);
+  void reduce(Eigen::Array<T, -1, -1> &, const Eigen::Array<T, -1, -1> &);
+  T * send_ghosts(std::size_t, const bool *);
+  void sent_ghosts(std::size_t);
+  const T * receive_ghosts(std::size_t, std::size_t);
+  void received_ghosts(std::size_t, std::size_t, unsigned);
+  template <typename A, typename F>
+  void reduce_slices(const A *, std::size_t, F);
 };
+
+/*
+  Sum over all the threads of the size elements pointed by part. It must be called by all the
+  threads of the parallel region. Each thread sums a slice of the elements over all the threads,
+  always in the same order and with compensated_add, and hands every sum to store(k, sum). The
+  slices are disjoint, so store may update shared data without any locking.
+*/
+template <typename T>
+template <typename A, typename F>
+void GLOBAL_VARIABLES<T>::reduce_slices(const A * part, std::size_t size, F store) {
+  const int nthreads = omp_get_num_threads();
+  const int id       = omp_get_thread_num();
+#pragma omp master
+  reduce_parts.assign(nthreads, nullptr);
+#pragma omp barrier
+  reduce_parts.at(id) = part;
+#pragma omp barrier
+  const std::size_t first = size * id / nthreads;
+  const std::size_t last  = size * (id + 1) / nthreads;
+  for(std::size_t k = first; k < last; k++){
+    A total = 0., err = 0.;
+    for(int t = 0; t < nthreads; t++)
+      compensated_add(total, err, static_cast<const A *>(reduce_parts[t])[k]);
+    store(k, total + err);
+  }
+#pragma omp barrier
+}
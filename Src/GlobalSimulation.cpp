@@ -33,17 +33,27 @@ GlobalSimulation<T,D>::GlobalSimulation( char *name ) : rglobal(name){
 
   Global.ghosts.resize( rglobal.get_BorderSize() );
   std::fill(Global.ghosts.begin(), Global.ghosts.end(), 0);
+  Global.ghosts_ready.assign(rglobal.n_threads * D, 0);
+  Global.ghosts_read.assign(2 * rglobal.n_threads * D, 0);
     
   H5::H5File * file12         = new H5::H5File(name, H5F_ACC_RDONLY);
   get_hdf5<double>(&EnergyScale,  file12, (char *)   "/EnergyScale");
   file12->close();
   delete file12;
   
+  tile = rglobal.tile;
+  
   omp_set_num_threads(rglobal.n_threads);
+  // The threads of the team of each domain are a nested parallel region inside the thread of the domain
+  if(rglobal.team > 1)
+    omp_set_max_active_levels(2);
   debug_message("Starting parallelization\n");
 #pragma omp parallel default(shared)
   {
-    Simulation<T,D> simul(name, Global);
+    if(rglobal.tile == 0)
+      tune_tile(name);
+    
+    Simulation<T,D> simul(name, Global, tile);
 
     simul.calc_conddc();
     simul.calc_condopt();
@@ -58,6 +68,65 @@ GlobalSimulation<T,D>::GlobalSimulation( char *name ) : rglobal(name){
   debug_message("Left global_simulation\n");
 }
 
+template <typename T,unsigned D>
+void GlobalSimulation<T,D>::tune_tile( char *name ){
+  /*
+    Chooses the tile size at run time (/Tile = 0 in the configuration file).
+    Every power of two between 8 and 256 that divides the subdomains is tried:
+    a Simulation is built with that tile and a few Chebyshev iterations are timed
+    with time_kpm, as done for the time estimates. The one with the shortest time of
+    the slowest thread is kept in tile.
+    Must be called by all the threads of the parallel region.
+  */
+  debug_message("Entered tune_tile\n");
+  const int N_average = 5;
+  std::vector<unsigned> candidates;
+  for(unsigned c = 8; c <= 256; c *= 2)
+    {
+      bool divides = true;
+      for(unsigned i = 0; i < D; i++)
+        divides = divides && (rglobal.Lt[i] % (rglobal.nd[i] * c) == 0);
+      if(divides)
+        candidates.push_back(c);
+    }
+
+  if(candidates.size() == 0){
+    std::cout << "The system size in each direction must be a multiple of the number of divisions in that ";
+    std::cout << "direction times a tile size, which can be at least 8. Exiting.\n";
+    exit(1);
+  }
+
+  double best = -1;
+  for(auto c = candidates.begin(); c != candidates.end(); c++)
+    {
+      double time;
+      {
+        Simulation<T,D> simul(name, Global, *c);
+        time = simul.time_kpm(N_average);
+      }
+      // Every iteration waits for the slowest domain, so the tiles are compared by
+      // the largest time over the threads
+#pragma omp master
+      Global.kpm_iteration_time = 0;
+#pragma omp barrier
+#pragma omp critical
+      Global.kpm_iteration_time = std::max(Global.kpm_iteration_time, time);
+#pragma omp barrier
+      verbose_message("Tile size "); verbose_message(*c); verbose_message(": ");
+      verbose_message(Global.kpm_iteration_time); verbose_message(" s per iteration\n");
+#pragma omp master
+      {
+        if(best < 0 || Global.kpm_iteration_time < best){
+          best = Global.kpm_iteration_time;
+          tile = *c;
+        }
+      }
+#pragma omp barrier
+    }
+  verbose_message("Selected tile size: "); verbose_message(tile); verbose_message("\n");
+  debug_message("Left tune_tile\n");
+}
+
 template class GlobalSimulation<float ,1u>;
 template class GlobalSimulation<double ,1u>;
 template class GlobalSimulation<long double ,1u>;
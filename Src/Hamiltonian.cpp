@@ -19,7 +19,7 @@
 
 extern "C" herr_t getMembers(hid_t loc_id, const char *name, void *opdata);
 template <typename T, unsigned D>
-Hamiltonian<T,D>::Hamiltonian(char *filename,  LatticeStructure<D> & rr, GLOBAL_VARIABLES <T> & gg) : name(filename), r(rr) , Global(gg),  hr(name, r), cross_mozaic(r.NStr), hV(name, rr, rnd)
+Hamiltonian<T,D>::Hamiltonian(char *filename,  LatticeStructure<D> & rr, GLOBAL_VARIABLES <T> & gg) : rnd(1), name(filename), r(rr) , Global(gg),  hr(name, r), cross_mozaic(r.NStr), hV(name, rr, rnd)
 {
   /* Anderson disorder */
   build_Anderson_disorder();
@@ -161,9 +161,19 @@ void Hamiltonian<T,D>::build_Anderson_disorder() {
 
     }
     catch (...){}
+
+    // Optional: 1 recomputes the gaussian and uniform energies on the fly, without storing them
+    int on_the_fly = 0;
+    try {
+      H5::Exception::dontPrint();
+      get_hdf5<int>(&on_the_fly, file, (char *) "/Hamiltonian/Disorder/OnsiteDisorderOnTheFly");
+    }
+    catch (H5::Exception& e){}
+    Anderson_on_the_fly = on_the_fly != 0;
     delete file;
   }
     
+  Anderson_realization = 0;
   Anderson_orb_address.resize(r.Orb);
   U_Orbital.resize(r.Orb);
   Eigen::Array<int,-1,-1> vv = Eigen::Map<Eigen::Array<int,-1,-1>>(orb_num.data(), dim[1], dim[0]);
@@ -182,6 +192,7 @@ void Hamiltonian<T,D>::build_Anderson_disorder() {
               Anderson_orb_address.at(io) = sum;
               count++;
             }
+          Anderson_model.push_back(i);
           sum++;
         }
       
@@ -198,7 +209,7 @@ void Hamiltonian<T,D>::build_Anderson_disorder() {
         }
     }
     
-  if(sum > 0)
+  if(sum > 0 && !Anderson_on_the_fly)
     U_Anderson.resize( sum * r.Nd);    
 }
 
@@ -215,27 +226,45 @@ void Hamiltonian<T,D>::build_velocity(std::vector<unsigned> & components, unsign
 template <typename T, unsigned D>  
 void Hamiltonian<T,D>::distribute_AndersonDisorder()
 {
-    
   /*
+   * The energies are keyed by the global index of the site and by the realization,
+   * so the ghosts get the same energies as the sites of the neighbouring domains
+   * they are copies of, and they can be computed again at any time
+   */
+  Anderson_realization = rnd.realization++;
+  if(Anderson_on_the_fly)
+    return;
+  
+  for (unsigned address = 0; address < Anderson_model.size(); address++)
+    for(std::size_t j = 0; j < r.Nd; j += r.Ld[0])
+      Anderson_row(&U_Anderson[address * r.Nd + j], address, j, r.Ld[0], 1);
+}
+
+template <typename T, unsigned D>  
+void Hamiltonian<T,D>::Anderson_row(value_type * U, int address, std::size_t j, std::size_t n, unsigned stride)
+{
+  /*
+   * Energies of the Anderson model at address for the n sites that start at the site j of the
+   * domain (Ld basis, no orbital) and lie in the same row. Each one is written stride times.
    * Gaussian      : 1
    * Uniform       : 2
-   * Deterministic : 3
    */
-    
-  int sum = 0;
-  for (unsigned i = 0; i < model.size(); i++)
-    if(model.at(i) == 1 )
-      {
-        for(unsigned j = 0; j < r.Nd; j++)
-          U_Anderson.at(sum + j) = rnd.gaussian(mu.at(i), sigma.at(i)) ;
-        sum += r.Nd;
-      }
-    else if ( model.at(i) == 2 )
-      {
-        for(unsigned j = 0; j < r.Nd; j++)
-          U_Anderson.at(sum + j) = rnd.uniform(mu.at(i), sigma.at(i)) ;
-        sum += r.Nd;
-      }
+  const unsigned i = Anderson_model[address];
+  const std::uint32_t stream = rnd.ANDERSON + i;
+  Coordinates<std::size_t, D + 1> x(r.Ld), z(r.Lt);
+  r.convertCoordinates(z, x.set_coord(j));
+  const std::size_t row = z.index - z.coord[0];
+  
+  for(std::size_t k = 0; k < n; k++)
+    {
+      const std::size_t site = row + (z.coord[0] + k) % r.Lt[0];
+      value_type u = 0;
+      if(model[i] == 1)
+        u = rnd.gaussian(mu[i], sigma[i], site, Anderson_realization, stream);
+      else if(model[i] == 2)
+        u = rnd.uniform(mu[i], sigma[i], site, Anderson_realization, stream);
+      std::fill_n(U + k * stride, stride, u);
+    }
 }
 
 
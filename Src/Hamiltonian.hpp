@@ -33,6 +33,9 @@ public:
   std::vector<value_type> U_Orbital;
   std::vector<value_type> U_Anderson;      // Local disorder  
   std::vector<int> Anderson_orb_address;
+  std::vector<unsigned> Anderson_model;    // Model of each address of Anderson_orb_address
+  bool Anderson_on_the_fly;                // Recompute the energies in the multiplication instead of storing U_Anderson
+  std::uint32_t Anderson_realization;
   
   /*   Structural disorder    */
   std::vector <bool>                   cross_mozaic;
@@ -46,6 +49,7 @@ public:
   void build_Anderson_disorder();
   void build_velocity(std::vector<unsigned> & components, unsigned n);
   void distribute_AndersonDisorder();
+  void Anderson_row(value_type * U, int address, std::size_t j, std::size_t n, unsigned stride);
 };
 
 
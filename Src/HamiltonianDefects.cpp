@@ -7,8 +7,8 @@
 
 
 #include "Generic.hpp"
-#include "Global.hpp"
 #include "ComplexTraits.hpp"
+#include "Global.hpp"
 #include "Random.hpp"
 #include "myHDF5.hpp"
 #include "Coordinates.hpp"
@@ -40,7 +40,7 @@ struct Defect_Operator: public ComplexTraits<T> {
 
 
   template <unsigned MULT, bool VELOCITY>  
-  void multiply_defect(std::size_t istr, T* & phi0, T* & phiM1, unsigned axis) {
+  void multiply_defect(std::size_t istr, T* & phi0, T* & phiM1, unsigned axis, unsigned NBlock = 1) {
     Coordinates<std::ptrdiff_t, D + 1>  local1(r.Ld);
     for(std::size_t i = 0; i <  position.at(istr).size(); i++)
       {
@@ -48,27 +48,29 @@ struct Defect_Operator: public ComplexTraits<T> {
         std::size_t iv = local1.set_coord(ip).coord[D - 1];
         for(unsigned k = 0; k < hopping.size(); k++)
           {
-            std::size_t k1 = ip + node_position[element1[k]];
-            std::size_t k2 = ip + node_position[element2[k]];
+            std::size_t k1 = (ip + node_position[element1[k]]) * NBlock;
+            std::size_t k2 = (ip + node_position[element2[k]]) * NBlock;
             
-            if(VELOCITY)
-              phi0[k1] += value_type(MULT + 1) * v.at(axis).at(k)*new_hopping(k, iv) * phiM1[k2] ;
-            else
-              phi0[k1] += value_type(MULT + 1) * new_hopping(k, iv) * phiM1[k2] ;
+            for(unsigned ib = 0; ib < NBlock; ib++)
+              if(VELOCITY)
+                phi0[k1 + ib] += value_type(MULT + 1) * v.at(axis).at(k)*new_hopping(k, iv) * phiM1[k2 + ib] ;
+              else
+                phi0[k1 + ib] += value_type(MULT + 1) * new_hopping(k, iv) * phiM1[k2 + ib] ;
           }
         
         if(!VELOCITY)
           for(std::size_t k = 0; k < U.size(); k++)
             {
-              std::size_t k1 = ip + node_position[element[k]];
-              phi0[k1] += value_type(MULT + 1) * U[k] * phiM1[k1];
+              std::size_t k1 = (ip + node_position[element[k]]) * NBlock;
+              for(unsigned ib = 0; ib < NBlock; ib++)
+                phi0[k1 + ib] += value_type(MULT + 1) * U[k] * phiM1[k1 + ib];
             }
       }
   }
 
   
-  template <unsigned MULT, bool VELOCITY>
-  void multiply_broken_defect(T* & phi0, T* & phiM1, unsigned axis) {
+  template <unsigned MULT, bool VELOCITY, bool FIELD = true>
+  void multiply_broken_defect(T* & phi0, T* & phiM1, unsigned axis, unsigned NBlock = 1) {
     Coordinates<std::ptrdiff_t, D + 1> global1(r.Lt), global2(r.Lt), local1(r.Ld) ;
     Eigen::Map<Eigen::Matrix<std::ptrdiff_t,2,1>> v_global1(global1.coord), v_global2(global2.coord);
     double phase;
@@ -79,23 +81,37 @@ struct Defect_Operator: public ComplexTraits<T> {
         std::size_t i1 = border_element1[i];
         std::size_t i2 = border_element2[i];
         
+        // Without magnetic field (FIELD false) the phase is 1
+        if(!FIELD)
+          {
+            for(unsigned ib = 0; ib < NBlock; ib++)
+              if(VELOCITY)
+                phi0[i1 * NBlock + ib] += value_type(MULT + 1) * border_v.at(axis).at(i) * border_hopping[i] * phiM1[i2 * NBlock + ib];
+              else
+                phi0[i1 * NBlock + ib] += value_type(MULT + 1) * border_hopping[i] * phiM1[i2 * NBlock + ib];
+            continue;
+          }
+        
         // These four lines pertrain only to the ghost_correlation
         r.convertCoordinates(global1, local1.set_coord(i1));
         r.convertCoordinates(global2, local1.set_coord(i2));
         temp_vect  = (v_global2 - v_global1).template cast<double>().matrix().transpose();
         phase = temp_vect(0)*r.ghost_pot(0,1)*v_global1(1); //.template cast<double>().matrix();
+        const T eiphase = multEiphase(phase);
         
-        if(VELOCITY)
-          phi0[i1] += value_type(MULT + 1) * border_v.at(axis).at(i) * border_hopping[i] * phiM1[i2] * multEiphase(phase);
-        else
-          phi0[i1] += value_type(MULT + 1) * border_hopping[i] * phiM1[i2] * multEiphase(phase);
+        for(unsigned ib = 0; ib < NBlock; ib++)
+          if(VELOCITY)
+            phi0[i1 * NBlock + ib] += value_type(MULT + 1) * border_v.at(axis).at(i) * border_hopping[i] * phiM1[i2 * NBlock + ib] * eiphase;
+          else
+            phi0[i1 * NBlock + ib] += value_type(MULT + 1) * border_hopping[i] * phiM1[i2 * NBlock + ib] * eiphase;
       }
     
     if(!VELOCITY)
       for(std::size_t i = 0; i < border_element.size(); i++)
         {
-          std::size_t i1 = border_element[i];
-          phi0[i1] += value_type(MULT + 1) * border_U[i] * phiM1[i1];
+          std::size_t i1 = border_element[i] * NBlock;
+          for(unsigned ib = 0; ib < NBlock; ib++)
+            phi0[i1 + ib] += value_type(MULT + 1) * border_U[i] * phiM1[i1 + ib];
         }
   }
 };
@@ -7,8 +7,8 @@
 
 
 #include "Generic.hpp"
-#include "Global.hpp"
 #include "ComplexTraits.hpp"
+#include "Global.hpp"
 #include "Random.hpp"
 #include "myHDF5.hpp"
 #include "Coordinates.hpp"
@@ -41,6 +41,12 @@ Periodic_Operator<T,D>::Periodic_Operator (char * name, LatticeStructure<D> & rr
     delete file;
     Convert_Build(r);
   }
+
+  // Without magnetic field all the rows have the same hoppings
+  phase_rows = (r.MagneticField != 0 ? r.ld[D - 1] : 1);
+  phase_offset.resize(r.Orb);
+  for(unsigned io = 0; io < r.Orb; io++)
+    phase_offset.at(io) = (io == 0 ? 0 : phase_offset.at(io - 1) + NHoppings(io - 1) * phase_rows);
   debug_message("Left Periodic_Operator constructor.\n");
 }
 
@@ -111,6 +117,10 @@ void Periodic_Operator<T,D>::build_velocity(std::vector<unsigned> & components,
     std::cout << "Simao esta a fazer asneira" << std::endl;
   //if(DEBUG) std::cout << "Finished calculating the phase.\n" << std::flush;
   Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> & v1 = v.at(n);
+  
+  // The cached hoppings of this velocity component are no longer valid
+  phase_tables.erase((n * 2 + 1) * 2 + 0);
+  phase_tables.erase((n * 2 + 1) * 2 + 1);
   for(unsigned io = 0; io < r.Orb; io++)
     {
       std::ptrdiff_t ip = io*Lda.basis[D];
@@ -132,6 +142,60 @@ void Periodic_Operator<T,D>::build_velocity(std::vector<unsigned> & components,
     }
 }
 
+template <typename T, unsigned D>
+const T * Periodic_Operator<T,D>::regular_hoppings(unsigned mult, bool velocity, unsigned axis)
+{
+  /*
+    Regular hoppings multiplied by (mult + 1), by the velocity factors of the component axis
+    when velocity is true, and by the Peierls phase of the magnetic field. The phase only
+    depends on the row along the last direction of the subdomain, so the table for each
+    combination is built the first time it is needed and reused by every KPM_MOTOR call.
+    Hopping ib of orbital io in row i (0 <= i < phase_rows) is at phase_offset[io] + i * NHoppings(io) + ib.
+    Without magnetic field there is a single row and no phase.
+  */
+  if(!velocity)
+    axis = 0;
+  const unsigned key = (axis * 2 + velocity) * 2 + mult;
+  auto found = phase_tables.find(key);
+  if(found != phase_tables.end())
+    return found->second.data();
+
+  std::vector<T> & table = phase_tables[key];
+  table.resize(phase_offset.at(r.Orb - 1) + NHoppings(r.Orb - 1) * phase_rows);
+  
+  Coordinates<std::ptrdiff_t, D + 1>  global(r.Lt);
+  Coordinates<std::ptrdiff_t, D + 1>  local1(r.Ld);
+  Coordinates<std::ptrdiff_t, D + 1>  b3(r.lB3);
+  Eigen::Map<Eigen::Matrix<std::ptrdiff_t,D, 1>> vee(b3.coord); // Column vector
+  std::ptrdiff_t xl[D + 1];
+  std::fill_n(xl, D + 1, 0);
+  
+  for(unsigned io = 0; io < r.Orb; io++)
+    for(unsigned ib = 0; ib < NHoppings(io); ib++)
+      {
+        T tt  = value_type(mult + 1) * hopping(ib, io);
+        b3.set_coord(dist(ib,io));
+        vee.array() -= 1;
+        if(velocity)
+          tt *= v.at(axis)(ib,io);
+        
+        if(r.MagneticField == 0)
+          {
+            table.at(phase_offset.at(io) + ib) = tt;
+            continue;
+          }
+        
+        for(std::size_t i = 0; i < phase_rows; i++)
+          {
+            xl[D - 1] = i + NGHOSTS;
+            xl[D] = io;
+            r.convertCoordinates(global, local1.set_index(xl));
+            value_type phase = vee(0) * global.coord[D - 1] * r.ghost_pot(0, D - 1);
+            table.at(phase_offset.at(io) + i * NHoppings(io) + ib) = tt * multEiphase(phase);
+          }
+      }
+  return table.data();
+}
 
 template struct Periodic_Operator<float, 1u>;
 template struct Periodic_Operator<double, 1u>;
@@ -20,7 +20,11 @@ struct Periodic_Operator : public ComplexTraits<T> {
   Eigen::Array<   T, Eigen::Dynamic, Eigen::Dynamic> hopping;                 // Hopping
   std::vector<Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic>>        v;
   Eigen::Matrix<int, Eigen::Dynamic, Eigen::Dynamic> dist; 
+  std::map<unsigned, std::vector<T>> phase_tables;                           // Hoppings with the Peierls phase of each row (see regular_hoppings)
+  std::vector<std::size_t> phase_offset;                                     // Start of each orbital in the phase tables
+  std::size_t phase_rows;                                                    // Rows in the phase tables (1 without magnetic field)
   Periodic_Operator<T,D>(char *, LatticeStructure <D> & );
   void Convert_Build (  LatticeStructure <D> &  );
   void build_velocity(std::vector<unsigned> & components, unsigned n);  
+  const T * regular_hoppings(unsigned mult, bool velocity, unsigned axis);
 };
@@ -23,7 +23,7 @@ class Simulation;
 #include "Simulation.hpp"
 
 template <typename T, unsigned D>
-KPM_Vector<T,D>::KPM_Vector(int mem, Simulation<T,D> & sim) : KPM_VectorBasis<T,D>(mem, sim), std(x.basis[1]), r(sim.r),h(sim.h),x(sim.r.Ld)  {
+KPM_Vector<T,D>::KPM_Vector(int mem, Simulation<T,D> & sim, unsigned nblock) : KPM_VectorBasis<T,D>(mem, sim, nblock), std(x.basis[1]), r(sim.r),h(sim.h),x(sim.r.Ld)  {
 }
 
 template <typename T, unsigned D>
@@ -32,6 +32,9 @@ KPM_Vector<T,D>::~KPM_Vector(void){}
 template <typename T, unsigned D>
 void KPM_Vector<T,D>::initiate_vector(){}
 
+template <typename T, unsigned D>
+void KPM_Vector<T,D>::initiate_vector(unsigned nvec){(void) nvec;}
+
 template <typename T, unsigned D>
 T KPM_Vector<T,D>::get_point(){return v(0,0);}
 
@@ -50,7 +53,7 @@ void KPM_Vector<T,D>::build_site(unsigned long pos){
 }
 
 template <typename T, unsigned D>
-void KPM_Vector <T, D>::build_planewave(Eigen::Matrix<double,-1,1> & k, Eigen::Matrix<T,-1,1> & weight){
+void KPM_Vector <T, D>::build_planewave(Eigen::Matrix<double,-1,-1> & k, Eigen::Matrix<T,-1,1> & weight){
   (void) k;
   (void) weight;
 }
@@ -113,6 +116,12 @@ void KPM_Vector<T,D>::measure_wave_packet(T * bra, T * ket, T * results){
 template <typename T, unsigned D>
 void KPM_Vector<T,D>::Exchange_Boundaries(){}
 
+template <typename T, unsigned D>
+void KPM_Vector<T,D>::refresh_ghosts(){}
+
+template <typename T, unsigned D>
+void KPM_Vector<T,D>::defer_exchange(bool defer){(void) defer;}
+
 template <typename T, unsigned D>
 void KPM_Vector<T,D>::test_boundaries_system(){}
 
@@ -31,6 +31,7 @@ public:
   using KPM_VectorBasis<T,D>::index;
   using KPM_VectorBasis<T,D>::v;
   using KPM_VectorBasis<T,D>::memory;
+  using KPM_VectorBasis<T,D>::NBlock;
   using KPM_VectorBasis<T,D>::aux_wr;
   using KPM_VectorBasis<T,D>::aux_test;
   using KPM_VectorBasis<T,D>::inc_index;
@@ -38,14 +39,15 @@ public:
   using KPM_VectorBasis<T,D>::myconj;
   using KPM_VectorBasis<T,D>::multEiphase;
   
-  KPM_Vector(int mem, Simulation<T,D> & sim);
+  KPM_Vector(int mem, Simulation<T,D> & sim, unsigned nblock = 1);
   ~KPM_Vector(void);
   void initiate_vector();
+  void initiate_vector(unsigned nvec);
   T get_point();
 
   void build_wave_packet(Eigen::Matrix<double,-1,-1> & k, Eigen::Matrix<T,-1,-1> & psi0, double & sigma,
                          Eigen::Matrix<double, 1, 2> & vb);
-  void build_planewave(Eigen::Matrix<double,-1,1> & k, Eigen::Matrix<T,-1,1> & weight);
+  void build_planewave(Eigen::Matrix<double,-1,-1> & k, Eigen::Matrix<T,-1,1> & weight);
   void build_site(unsigned long R);
 
   template < unsigned MULT,bool VELOCITY> 
@@ -57,6 +59,8 @@ public:
   void inline mult_regular_hoppings(const  std::size_t & j0, const  std::size_t & io);
   template <unsigned MULT> 
   void Multiply(){}
+  template <unsigned MULT>
+  void Multiply(const T *, Eigen::Matrix<typename accumulator_type<T>::type, -1, 2> &){}
 
   void Velocity(T * phi0,T * phiM1, unsigned axis);
   void Velocity(T * phi0,T * phiM1, int axis);
@@ -64,6 +68,8 @@ public:
   void KPM_MOTOR(T * phi0a, T * phiM1a, T *phiM2a, unsigned axis);
   void measure_wave_packet(T * bra, T * ket, T * results);  
   void Exchange_Boundaries();
+  void refresh_ghosts();
+  void defer_exchange(bool defer);
   void test_boundaries_system();
   void empty_ghosts(int mem_index);
 
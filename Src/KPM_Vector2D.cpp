@@ -26,8 +26,8 @@ class Simulation;
 
 
 template <typename T>
-KPM_Vector<T,2u>::KPM_Vector(int mem, Simulation<T,2> & sim) :
-  KPM_VectorBasis<T,2>(mem, sim),
+KPM_Vector<T,2u>::KPM_Vector(int mem, Simulation<T,2> & sim, unsigned nblock) :
+  KPM_VectorBasis<T,2>(mem, sim, nblock),
   r(sim.r),
   tile{r.Ld[0], 1},
   tile_ghosts{1, r.Ld[0]},
@@ -40,13 +40,14 @@ KPM_Vector<T,2u>::KPM_Vector(int mem, Simulation<T,2> & sim) :
   Coordinates <std::size_t, 3>     z(r.Ld);
   Coordinates <int, 3> x(r.nd), dist(r.nd);
   
-  mult_t1_ghost_cor = new T**[r.Orb];
-  for(unsigned io = 0; io < r.Orb; io++)
-    {
-      mult_t1_ghost_cor[io] = new T*[h.hr.NHoppings(io)];
-      for(unsigned ib = 0; ib < h.hr.NHoppings(io); ib++)
-        mult_t1_ghost_cor[io][ib] = new T[TILE];
-    }
+  // One slice of the scratch rows for each thread of the team
+  row_distances.resize(r.team * h.hr.NHoppings.maxCoeff());
+  row_onsite.resize(r.team * r.Ld[0] * NBlock);
+  // The ghosts can be recomputed locally when all the terms of the Hamiltonian are translation invariant
+  // functions of the global position: no magnetic field, no structural disorder and no vacancies
+  s_step = (r.MagneticField == 0 && h.hd.empty() && h.hV.concentration.empty());
+  dot_bra = nullptr;
+  dot_mu = nullptr;
 
   for(unsigned d = 0; d < 2; d++)
     for(unsigned b = 0; b < 2; b++)
@@ -102,7 +103,10 @@ KPM_Vector<T,2u>::KPM_Vector(int mem, Simulation<T,2> & sim) :
         dist.coord[d] = int(b) * 2 - 1;
         block[d][b] = x.set_coord( int(r.thread_id) ).add(dist).index;
       }
+  // The vector starts random, but the random vectors of the traces are numbered from the first
+  // one used, whatever the number and the blocks of the vectors constructed before
   initiate_vector();
+  simul.rnd.vectors -= NBlock;
 }
 
 template <typename T>
@@ -113,30 +117,42 @@ KPM_Vector <T, 2>::~KPM_Vector(void){
         delete MemIndBeg[d][b];
         delete MemIndEnd[d][b];
       }
-  for(unsigned io = 0; io < r.Orb;io++)
-    {	
-      for(unsigned ib = 0; ib < h.hr.NHoppings(io); ib++)
-        delete mult_t1_ghost_cor[io][ib];
-      delete mult_t1_ghost_cor[io];
-    }
-  delete mult_t1_ghost_cor;
 }
 
 
 template <typename T>
 void KPM_Vector <T, 2>::initiate_vector() {
+  initiate_vector(NBlock);
+}
+
+template <typename T>
+void KPM_Vector <T, 2>::initiate_vector(unsigned nvec) {
+  // The first nvec vectors of the block are random, the remaining ones are set to zero
+  // The random numbers are keyed by the global site index, so they do not depend on the domain decomposition
   index = 0;
-  Coordinates<std::size_t, 3> x(r.Ld);
-  for(std::size_t io = 0; io < r.Orb; io++)
-    for(std::size_t i1 = NGHOSTS; i1 < r.Ld[1] - NGHOSTS; i1++)
-      for(std::size_t i0 = NGHOSTS; i0 < r.Ld[0] - NGHOSTS; i0++)
-        v(x.set({i0,i1,io}).index, index) = simul.rnd.init()/static_cast<value_type>(sqrt(value_type(r.Sizet - r.SizetVacancies)));
+  const value_type norm = static_cast<value_type>(sqrt(value_type(r.Sizet - r.SizetVacancies)));
+  Coordinates<std::size_t, 3> x(r.Ld), z(r.Lt);
+  for(unsigned ib = 0; ib < NBlock; ib++)
+    for(std::size_t io = 0; io < r.Orb; io++)
+      for(std::size_t i1 = NGHOSTS; i1 < r.Ld[1] - NGHOSTS; i1++)
+        {
+          x.set({std::size_t(NGHOSTS),i1,io});
+          if(ib < nvec)
+            {
+              r.convertCoordinates(z, x);
+              simul.rnd.init_row(&v(x.index * NBlock + ib, index), NBlock, z.index, r.ld[0], simul.rnd.vectors + ib, norm);
+            }
+          else
+            for(std::size_t i0 = 0; i0 < r.ld[0]; i0++)
+              v((x.index + i0) * NBlock + ib, index) = 0.;
+        }
+  simul.rnd.vectors += nvec;
   
   for(unsigned i = 0; i < r.NStr; i++)
     {
       auto & vv = h.hV.position.at(i); 
       for(unsigned j = 0; j < vv.size(); j++)
-        v(vv.at(j), index ) = 0. ;
+        v.col(index).segment(vv.at(j) * NBlock, NBlock).setZero();
     }
   
 }
@@ -195,8 +211,8 @@ void KPM_Vector <T, 2>::build_site(unsigned long pos){
 }
 
 template <typename T>
-void KPM_Vector <T, 2>::build_planewave(Eigen::Matrix<double,-1,1> & k, Eigen::Matrix<T,-1,1> & weight){
-    // Builds an initial vector which is a plane wave with a specific value of k
+void KPM_Vector <T, 2>::build_planewave(Eigen::Matrix<double,-1,-1> & k, Eigen::Matrix<T,-1,1> & weight){
+    // Builds an initial block of plane waves, one for each column of k. The remaining vectors of the block are zero
     // weight is the weight of each orbital for this plane wave 
     // |k> = sum_{r,R} w(R) exp(i k.r + i k.R) |r,R>
     // r = lattice vector
@@ -209,34 +225,39 @@ void KPM_Vector <T, 2>::build_planewave(Eigen::Matrix<double,-1,1> & k, Eigen::M
 
 
     index = 0;    // sets the KPM index to 0
+    v.col(0).setZero();
+    const unsigned nk = k.cols();
     Coordinates<std::size_t, 3> local_coords(r.Ld), global_coords(r.Lt);
+    r.convertCoordinates(global_coords, local_coords.set({std::size_t(NGHOSTS), std::size_t(NGHOSTS), std::size_t(0)}));
 
-    Eigen::Map<Eigen::Matrix<std::size_t, 2, 1>> position(global_coords.coord); // spacial part of the coord vector in global_coords
     auto orb_a_coords = r.rLat.inverse() * r.rOrb;          // column i is the position of the i-th orbital in basis a
                                                             // r.rLat.inverse() each row is a bi / 2*M_PI 
-    Eigen::Array<T, -1, 1> exp_R;
-    exp_R = Eigen::Array<T, -1, 1>::Zero(r.Orb, 1);   // exponential related to the orbital
-    T exp_r;                                                // exponential related to the lattice site
+    Eigen::Array<T, -1, -1> exp_R(r.Orb, nk);               // exponential related to the orbital
+    Eigen::Array<T, -1, -1> exp_r[2];                       // exponential related to the lattice site, along each direction
 
     // Calculate the exponential related to the orbital exp(i k R) w(R)
     // It is already divided by the norm, which is the number of total sites r.Nt
-    for(std::size_t io = 0; io < r.Orb; io++)
-        exp_R(io) = weight(io)*exp(assign_value(0, 2.0*M_PI*orb_a_coords.col(io).transpose()*k))/T(sqrt(r.Nt));
-
-    // Calculate the exponential related to each unit cell
-    for(std::size_t i1 = NGHOSTS; i1 < r.Ld[1] - NGHOSTS; i1++){
-        for(std::size_t i0 = NGHOSTS; i0 < r.Ld[0] - NGHOSTS; i0++){
-            local_coords.set({i0,i1,std::size_t(0)});
-            r.convertCoordinates(global_coords, local_coords);          // Converts the coordinates within a thread to global coordinates
+    for(unsigned ik = 0; ik < nk; ik++)
+      for(std::size_t io = 0; io < r.Orb; io++)
+        exp_R(io, ik) = weight(io)*multEiphase(2.0*M_PI*orb_a_coords.col(io).dot(k.col(ik)))/T(sqrt(r.Nt));
 
-            exp_r = exp(assign_value(0,  2.0*M_PI * position.cast<double>().transpose()*k ));
+    // exp(i k.r) factorizes along the lattice vectors, so it is tabulated once for each direction of the domain
+    for(unsigned d = 0; d < 2; d++)
+      {
+        exp_r[d].resize(r.ld[d], nk);
+        for(unsigned ik = 0; ik < nk; ik++)
+          for(std::size_t i = 0; i < r.ld[d]; i++)
+            exp_r[d](i, ik) = multEiphase(2.0*M_PI*double(global_coords.coord[d] + i)*k(d, ik));
+      }
 
-            for(std::size_t io = 0; io < r.Orb; io++){
-                local_coords.set({i0,i1,io});
-                v(local_coords.index, 0) = exp_r*exp_R(io);
-            }
-        }
-    }
+    for(std::size_t io = 0; io < r.Orb; io++)
+      for(std::size_t i1 = 0; i1 < r.ld[1]; i1++)
+        for(std::size_t i0 = 0; i0 < r.ld[0]; i0++)
+          {
+            const std::size_t j = local_coords.set({i0 + NGHOSTS, i1 + NGHOSTS, io}).index * NBlock;
+            for(unsigned ik = 0; ik < nk; ik++)
+              v(j + ik, 0) = exp_r[0](i0, ik)*exp_r[1](i1, ik)*exp_R(io, ik);
+          }
 }
 
 
@@ -316,44 +337,6 @@ void KPM_Vector <T, 2>::build_wave_packet(Eigen::Matrix<double,-1,-1> & k, Eigen
         }
 }
 
-template <typename T>
-template < unsigned MULT,bool VELOCITY> 
-void KPM_Vector <T, 2>::build_regular_phases(int i1, unsigned axis)
-{
-  unsigned l[2 + 1], count;
-  Coordinates<std::ptrdiff_t, 3>  global(r.Lt);
-  Coordinates<std::ptrdiff_t, 3> local1(r.Ld);
-  Coordinates<std::size_t,3> x(r.Ld);
-  std::fill_n(l, 2, 3);
-  l[2]  = r.Orb;
-  Coordinates<std::ptrdiff_t, 2 + 1> b3(l);    
-  Eigen::Map<Eigen::Matrix<std::ptrdiff_t,2, 1>> vee(b3.coord); // Column vector
-    
-    
-  for(unsigned io = 0; io < r.Orb; io++)
-    {
-      const std::size_t ip = io * x.basis[2] ;
-      const std::size_t j0 = ip + 0 + i1 * std;
-      const std::size_t j1 = j0 + TILE * std;
-
-      for(unsigned ib = 0; ib < h.hr.NHoppings(io); ib++)
-        {
-          T tt  = value_type(MULT + 1) * h.hr.hopping(ib, io);
-          b3.set_coord(h.hr.dist(ib,io));        
-          vee.array() -= 1;
-          count = 0;
-          if (VELOCITY)  tt  *=  h.hr.v.at(axis)(ib,io);
-          for(std::size_t j = j0; j < j1; j += std )
-            {
-              r.convertCoordinates(global, local1.set_coord(j));
-              value_type phase = vee(0)*global.coord[1]*r.ghost_pot(0,1);
-              mult_t1_ghost_cor[io][ib][count] =  tt * multEiphase(phase);
-              count++;
-            }
-        }
-    }
-}
-
 template <typename T>
 template < unsigned MULT> 
 void KPM_Vector <T, 2>::initiate_stride(std::size_t & istr)
@@ -361,59 +344,69 @@ void KPM_Vector <T, 2>::initiate_stride(std::size_t & istr)
   std::size_t i0, i1;
   const std::size_t std = x.basis[1];
   // Periodic component of the Hamiltonian + Anderson disorder
-  i0 = ((istr) % (r.lStr[0]) ) * TILE + NGHOSTS;
-  i1 = ((istr) / r.lStr[0] ) * TILE + NGHOSTS;
+  i0 = ((istr) % (r.lStr[0]) ) * r.tile + NGHOSTS;
+  i1 = ((istr) / r.lStr[0] ) * r.tile + NGHOSTS;
   
   for(std::size_t io = 0; io < r.Orb; io++)
     {
       const std::size_t ip = io * x.basis[2];
       const std::size_t j0 = ip + i0 + i1 * std;
-      const std::size_t j1 = j0 + TILE * std; //j0 and j1 define the limits of the for cycle
+      const std::size_t j1 = j0 + r.tile * std; //j0 and j1 define the limits of the for cycle
 
 
       for(std::size_t j = j0; j < j1; j += std )
-        for(std::size_t i = j; i < j + TILE ; i++)
+        for(std::size_t i = j * NBlock; i < (j + r.tile) * NBlock ; i++)
           phi0[i] = - value_type(MULT) * phiM2[i];
     }
 }
 
 template <typename T>
-template < unsigned MULT> 
-void inline KPM_Vector <T, 2>::mult_local_disorder(const  std::size_t & j0, const  std::size_t & io)
+template <unsigned MULT, bool VELOCITY, bool FIELD> 
+void inline KPM_Vector <T, 2>::mult_tile(const  std::size_t & j0, const  std::size_t & io, std::size_t row, bool init, unsigned it)
 {
-  const std::size_t j1 = j0 + TILE * std;
+  // Local energy and regular hoppings of the orbital io, applied row by row in a single pass
+  // it is the thread of the team, which has its own slice of row_distances and row_onsite
+  const std::size_t j1 = j0 + r.tile * std;
+  const unsigned nhop = h.hr.NHoppings(io);
   const std::ptrdiff_t dd = (h.Anderson_orb_address[io] - std::ptrdiff_t(io))*r.Nd;
-  // Anderson disorder
-  if( h.Anderson_orb_address[io] >= 0)
+  const value_type * U = nullptr;
+  std::ptrdiff_t * distances = row_distances.data() + it * (row_distances.size() / r.team);
+  value_type * onsite = row_onsite.data() + it * (row_onsite.size() / r.team);
+  
+  for(unsigned ib = 0; ib < nhop; ib++)
+    distances[ib] = h.hr.distance(ib, io) * std::ptrdiff_t(NBlock);
+  
+  if(!VELOCITY && h.Anderson_orb_address[io] == - 1)
     {
-      for(std::size_t j = j0; j < j1; j += std )
-        for(std::size_t i = j; i < j + TILE ; i++)
-          phi0[i] += value_type(MULT + 1) * phiM1[i] * h.U_Anderson.at(i + dd);
+      std::fill_n(onsite, r.tile * NBlock, h.U_Orbital.at(io));
+      U = onsite;
     }
-  else if (h.Anderson_orb_address[io] == - 1)
-    {
-      for(std::size_t j = j0; j < j1; j += std )
-        for(std::size_t i = j; i < j + TILE ; i++)
-          phi0[i] += value_type(MULT + 1) * phiM1[i] * h.U_Orbital.at(io);
-    }
-}
-
-template <typename T>
-void inline KPM_Vector <T, 2>::mult_regular_hoppings(const  std::size_t & j0, const  std::size_t & io)
-{
-  std::size_t count;
-  const std::size_t j1 = j0 + TILE * std;
-  // Hoppings
-  for(unsigned ib = 0; ib < h.hr.NHoppings(io); ib++)
+  
+  for(std::size_t j = j0; j < j1; j += std )
     {
-      const std::ptrdiff_t d1 = h.hr.distance(ib, io);
-      count = 0;
-      for(std::size_t j = j0; j < j1; j += std )
+      // Anderson disorder
+      if(!VELOCITY && h.Anderson_orb_address[io] >= 0)
         {
-          const T t1 = mult_t1_ghost_cor[io][ib][count++];
-          for(std::size_t i = j; i < j + TILE ; i++)
-            phi0[i] += t1 * phiM1[i + d1];								
+          if(h.Anderson_on_the_fly)
+            {
+              h.Anderson_row(onsite, h.Anderson_orb_address[io], j - io * r.Nd, r.tile, NBlock);
+              U = onsite;
+            }
+          else if(NBlock == 1)
+            U = &h.U_Anderson.at(j + dd);
+          else
+            {
+              for(std::size_t i = 0; i < r.tile; i++)
+                std::fill_n(onsite + i * NBlock, NBlock, h.U_Anderson.at(j + i + dd));
+              U = onsite;
+            }
         }
+      
+      const T * t = hoppings + h.hr.phase_offset[io] + (FIELD ? row * nhop : 0);
+      row++;
+      
+      this->template stencil_row<MULT>(phi0 + j * NBlock, phiM1 + j * NBlock, phiM2 + j * NBlock, r.tile * NBlock, init,
+                                       U, nhop, t, distances);
     }
 }
 
@@ -422,18 +415,62 @@ void inline KPM_Vector <T, 2>::mult_regular_hoppings(const  std::size_t & j0, co
 
 template <typename T>
 void KPM_Vector <T, 2>::Velocity(T * phi0,T * phiM1, unsigned axis) {
-  KPM_MOTOR<0u, true>(phi0, phiM1, phiM1, axis);
+  if(r.MagneticField != 0)
+    KPM_MOTOR<0u, true, true>(phi0, phiM1, phiM1, axis);
+  else
+    KPM_MOTOR<0u, true, false>(phi0, phiM1, phiM1, axis);
+  invalidate_ghosts();
 }
 template <typename T>
 void KPM_Vector <T, 2>::Velocity(T * phi0,T * phiM1, int axis) {
-  KPM_MOTOR<0u, true>(phi0, phiM1, phiM1, axis);
+  if(r.MagneticField != 0)
+    KPM_MOTOR<0u, true, true>(phi0, phiM1, phiM1, axis);
+  else
+    KPM_MOTOR<0u, true, false>(phi0, phiM1, phiM1, axis);
+  invalidate_ghosts();
 }
 
 template <typename T>
-template <unsigned MULT, bool VELOCITY>
+template <unsigned MULT, bool VELOCITY, bool FIELD>
+void KPM_Vector <T, 2>::motor_tile(std::size_t istr, unsigned axis, unsigned it, accumulator * mu, accumulator * err)
+{
+  // Stencil of the tile istr, done by the thread it of the team. The products are added to mu and err
+  const std::size_t i0 = istr % r.lStr[0] * r.tile + NGHOSTS;
+  const std::size_t i1 = istr / r.lStr[0] * r.tile + NGHOSTS;
+  
+  // Tiles out of the light cone stay zero (see light_cone)
+  if(!VELOCITY && cone && !(cone_tiles[0][(i0 - NGHOSTS) / r.tile] && cone_tiles[1][(i1 - NGHOSTS) / r.tile]))
+    return;
+  
+  // Tiles that were not initialized in advance are initialized inside the stencil
+  const bool init = h.cross_mozaic.at(istr);
+  for(std::size_t io = 0; io < r.Orb; io++)
+    {
+      const std::size_t ip = io * x.basis[2];
+      const std::size_t j0 = ip + i0 + i1 * std;
+      
+      // Local Energy and Hoppings
+      mult_tile<MULT, VELOCITY, FIELD>(j0, io, i1 - NGHOSTS, init, it);
+    }
+  for(auto id = h.hd.begin(); id != h.hd.end(); id++)
+    id->template multiply_defect<MULT, VELOCITY>(istr, phi0, phiM1, axis, NBlock);
+  
+  // Empty the vacancies in the tile
+  auto & hV = h.hV.position.at(istr);
+  for(auto k = hV.begin(); k != hV.end(); k++)
+    std::fill_n(phi0 + *k * NBlock, NBlock, 0.);
+  
+  // Products with the finished tile, while it is still in cache
+  if(mu != nullptr)
+    for(std::size_t io = 0; io < r.Orb; io++)
+      for(std::size_t j = io * x.basis[2] + i0 + i1 * std; j < io * x.basis[2] + i0 + (i1 + r.tile) * std; j += std)
+        this->dot_row((dot_bra == nullptr ? phiM1 : dot_bra) + j * NBlock, phiM1 + j * NBlock, phi0 + j * NBlock, r.tile, mu, err);
+}
+
+template <typename T>
+template <unsigned MULT, bool VELOCITY, bool FIELD>
 void KPM_Vector <T, 2>::KPM_MOTOR(T * phi0a, T * phiM1a, T *phiM2a, unsigned axis)
 {
-  std::size_t i0, i1;    
   phi0 = phi0a;
   phiM1 = phiM1a;
   phiM2 = phiM2a;
@@ -442,41 +479,38 @@ void KPM_Vector <T, 2>::KPM_MOTOR(T * phi0a, T * phiM1a, T *phiM2a, unsigned axi
   for(auto istr = h.cross_mozaic_indexes.begin(); istr != h.cross_mozaic_indexes.end() ; istr++)
     initiate_stride<MULT>(*istr);
     
-  for( i1 = NGHOSTS; i1 < r.Ld[1] - NGHOSTS; i1 += TILE  )
+  hoppings = h.hr.regular_hoppings(MULT, VELOCITY, axis);
+  
+  // The tiles are shared by the team of the domain, unless the defects reach into the tiles of other threads
+  const unsigned team = (h.hd.empty() ? r.team : 1);
+  if(team == 1)
+    for(std::size_t istr = 0; istr < r.NStr; istr++)
+      motor_tile<MULT, VELOCITY, FIELD>(istr, axis, 0, dot_mu, dot_err.data());
+  else
     {
-      build_regular_phases<MULT,VELOCITY>(i1, axis);
-		
-      for( i0 = NGHOSTS; i0 < r.Ld[0] - NGHOSTS; i0 += TILE )
-        {
-		    
-          std::size_t istr = (i1 - NGHOSTS) / TILE * r.lStr[0] + (i0 - NGHOSTS) / TILE;
-          if(h.cross_mozaic.at(istr))
-            initiate_stride<MULT>(istr);
-          // These four lines pertrain only to the magnetic field
-          for(std::size_t io = 0; io < r.Orb; io++)
+      // Each thread sums its own products, which are added in the order of the threads
+      if(dot_mu != nullptr)
+        team_dots.setZero(2 * NBlock, 2 * team);
+#pragma omp parallel num_threads(team)
+      {
+        const unsigned it = omp_get_thread_num();
+        accumulator * mu = (dot_mu == nullptr ? nullptr : team_dots.col(2 * it).data());
+        accumulator * err = (dot_mu == nullptr ? nullptr : team_dots.col(2 * it + 1).data());
+#pragma omp for schedule(static)
+        for(std::size_t istr = 0; istr < r.NStr; istr++)
+          motor_tile<MULT, VELOCITY, FIELD>(istr, axis, it, mu, err);
+      }
+      if(dot_mu != nullptr)
+        for(unsigned it = 0; it < team; it++)
+          for(unsigned k = 0; k < 2 * NBlock; k++)
             {
-              const std::size_t ip = io * x.basis[2];
-              const std::size_t j0 = ip + i0 + i1 * std;
-		
-              // Local Energy
-              if(!VELOCITY) mult_local_disorder<MULT>(j0, io);
-		
-              // Hoppings
-              mult_regular_hoppings(j0, io);
+              compensated_add(dot_mu[k], dot_err.data()[k], team_dots(k, 2 * it));
+              dot_err.data()[k] += team_dots(k, 2 * it + 1);
             }
-          for(auto id = h.hd.begin(); id != h.hd.end(); id++)
-            id->template multiply_defect<MULT, VELOCITY>(istr, phi0, phiM1, axis);
-	  	    
-          // Empty the vacancies in the tile
-          auto & hV = h.hV.position.at(istr);
-          for(auto k = hV.begin(); k != hV.end(); k++)
-            phi0[*k] = 0.;
-
-        }
     }
 
   for(auto vc =  h.hV.vacancies_with_defects.begin(); vc != h.hV.vacancies_with_defects.end(); vc++)
-    phi0[*vc] = 0.;
+    std::fill_n(phi0 + *vc * NBlock, NBlock, 0.);
 
     
   /* 
@@ -487,10 +521,7 @@ void KPM_Vector <T, 2>::KPM_MOTOR(T * phi0a, T * phiM1a, T *phiM2a, unsigned axi
   */
     
   for(auto id = h.hd.begin(); id != h.hd.end(); id++)
-    id->template multiply_broken_defect<MULT,VELOCITY>(phi0, phiM1,axis);
-	  
-  // These four lines pertrain only to the magnetic field
-  Exchange_Boundaries();
+    id->template multiply_broken_defect<MULT, VELOCITY, FIELD>(phi0, phiM1, axis, NBlock);
 }
 template <typename T>
 void KPM_Vector <T, 2>::measure_wave_packet(T * bra, T * ket, T * results)  
@@ -540,70 +571,118 @@ void KPM_Vector <T, 2>::measure_wave_packet(T * bra, T * ket, T * results)
 }
 template <typename T>
 void KPM_Vector <T, 2>::Exchange_Boundaries() {
+  Exchange_Boundaries(1);
+}
+
+template <typename T>
+void KPM_Vector <T, 2>::Exchange_Boundaries(unsigned ncols) {
   /*
     I have four boundaries to exchange with the other threads.
-    First I will copy the lines along the a[1] direction to a consecutive shared vector
+    The edges of each direction are packed in a slot of Global.ghosts that belongs to this thread,
+    from where the neighbours copy them to their ghosts. Each thread only waits for its own
+    neighbours (see GLOBAL_VARIABLES::send_ghosts). The edges along a[1] carry the corners
+    received along a[0], so the two directions are exchanged one after the other.
+    A domain that is its own neighbour copies its edges straight to its ghosts.
+    The columns index, index - 1, ..., index - ncols + 1 are exchanged together
   */
-#pragma omp barrier    
-  Coordinates<std::size_t,3u> x(r.Ld), z(r.Lt);
-  T  *phi = v.col(index).data();
-
-    
   for(unsigned d = 0; d < 2; d++)
     {
-      std::size_t BSize = r.Orb * transf_max[d] * NGHOSTS;
-      T * ghosts_left = & simul.ghosts[0];
-      T * ghosts_right = & simul.ghosts[BSize];
+      std::size_t CSize = r.Orb * transf_max[d] * NGHOSTS * NBlock;
+      std::size_t BSize = ncols * CSize;
+      std::size_t slot  = r.thread_id * D + d;
 
-      for(std::size_t io = 0; io < r.Orb; io++)
+      if(r.nd[d] == 1)
         {
-          std::size_t il = MemIndBeg[d][0][io];
-          std::size_t ir = MemIndBeg[d][1][io];
-	    
-          for(std::size_t i = 0; i < transf_bound[d][0]; i++)
-            {
-              for(unsigned ig = 0; ig < NGHOSTS; ig++)
-                ghosts_left [i + (ig + NGHOSTS*io) * transf_bound[d][0] ] = phi[il + ig * tile_ghosts[d]];
-              il += tile[d];
-            }
-	    
-          for(std::size_t i = 0; i < transf_bound[d][1]; i++)
+          for(unsigned c = 0; c < ncols; c++)
             {
-              for(unsigned ig = 0; ig < NGHOSTS; ig++)
-                ghosts_right[i + (ig + NGHOSTS*io) * transf_bound[d][1] ] = phi[ir + ig * tile_ghosts[d]];
-              ir += tile[d];
+              T  *phi = v.col((memory + index - c) % memory).data();
+              for(std::size_t io = 0; io < r.Orb; io++)
+                for(unsigned edge = 0; edge < 2; edge++)
+                  {
+                    std::size_t is = MemIndBeg[d][edge][io];
+                    std::size_t ie = MemIndEnd[d][1 - edge][io];
+                    for(std::size_t i = 0; i < transf_bound[d][edge]; i++)
+                      {
+                        for(unsigned ig = 0; ig < NGHOSTS; ig++)
+                          std::copy_n(phi + (is + ig * tile_ghosts[d]) * NBlock, NBlock, phi + (ie + ig * tile_ghosts[d]) * NBlock);
+                        is += tile[d];
+                        ie += tile[d];
+                      }
+                  }
             }
+          continue;
         }
-	
-      // Copy the boundaries to the shared memory
-      std::copy( ghosts_left, ghosts_left + 2*BSize, simul.Global.ghosts.begin() + 2*BSize * r.thread_id );	  
-#pragma omp barrier
-      auto neigh_left = simul.Global.ghosts.begin() + 2 * block[d][0] * BSize;
-      auto neigh_right  = simul.Global.ghosts.begin() + 2 * block[d][1] * BSize;
-      std::copy(neigh_right,         neigh_right + BSize , ghosts_right );     // From the left to the right
-      std::copy(neigh_left + BSize,  neigh_left + 2*BSize, ghosts_left  )  ;   // From the right to the left
-	
-#pragma omp barrier	
-      for(std::size_t io = 0; io < r.Orb; io++)
+
+      T * ghosts_left = simul.Global.send_ghosts(slot, r.boundary[d]);
+      T * ghosts_right = ghosts_left + BSize;
+
+      for(unsigned c = 0; c < ncols; c++)
         {
-          std::size_t il = MemIndEnd[d][0][io];
-          std::size_t ir = MemIndEnd[d][1][io];
-	    
-          for(std::size_t i = 0; i < transf_bound[d][0]; i++)
+          T  *phi = v.col((memory + index - c) % memory).data();
+          T  *left = ghosts_left + c * CSize, *right = ghosts_right + c * CSize;
+          for(std::size_t io = 0; io < r.Orb; io++)
             {
-              for(int ig = 0; ig < NGHOSTS; ig++)
-                phi[il + ig * tile_ghosts[d]] = ghosts_left [i + (ig + NGHOSTS * io) * transf_bound[d][0]];
-              il += tile[d];
-            }
+              std::size_t il = MemIndBeg[d][0][io];
+              std::size_t ir = MemIndBeg[d][1][io];
 	    
-          for(std::size_t i = 0; i < transf_bound[d][1]; i++)
+              for(std::size_t i = 0; i < transf_bound[d][0]; i++)
+                {
+                  for(unsigned ig = 0; ig < NGHOSTS; ig++)
+                    for(unsigned ib = 0; ib < NBlock; ib++)
+                      left [(i + (ig + NGHOSTS*io) * transf_bound[d][0]) * NBlock + ib] = phi[(il + ig * tile_ghosts[d]) * NBlock + ib];
+                  il += tile[d];
+                }
+	    
+              for(std::size_t i = 0; i < transf_bound[d][1]; i++)
+                {
+                  for(unsigned ig = 0; ig < NGHOSTS; ig++)
+                    for(unsigned ib = 0; ib < NBlock; ib++)
+                      right[(i + (ig + NGHOSTS*io) * transf_bound[d][1]) * NBlock + ib] = phi[(ir + ig * tile_ghosts[d]) * NBlock + ib];
+                  ir += tile[d];
+                }
+            }
+        }
+      simul.Global.sent_ghosts(slot);
+
+      // The left neighbour sends its right edge and the right neighbour its left edge
+      for(unsigned edge = 0; edge < 2; edge++)
+        {
+          if(!r.boundary[d][edge])
+            continue;
+          std::size_t from = block[d][edge] * D + d;
+          const T * ghosts = simul.Global.receive_ghosts(slot, from) + (1 - edge) * BSize;
+          for(unsigned c = 0; c < ncols; c++)
             {
-              for(int ig = 0; ig < NGHOSTS; ig++)
-                phi[ir + ig * tile_ghosts[d]] = ghosts_right[i + (ig + NGHOSTS * io) * transf_bound[d][1]];
-              ir += tile[d];
+              T  *phi = v.col((memory + index - c) % memory).data();
+              const T *edge_ghosts = ghosts + c * CSize;
+              for(std::size_t io = 0; io < r.Orb; io++)
+                {
+                  std::size_t ie = MemIndEnd[d][edge][io];
+                  for(std::size_t i = 0; i < transf_bound[d][edge]; i++)
+                    {
+                      for(int ig = 0; ig < NGHOSTS; ig++)
+                        for(unsigned ib = 0; ib < NBlock; ib++)
+                          phi[(ie + ig * tile_ghosts[d]) * NBlock + ib] = edge_ghosts[(i + (ig + NGHOSTS * io) * transf_bound[d][edge]) * NBlock + ib];
+                      ie += tile[d];
+                    }
+                }
             }
+          simul.Global.received_ghosts(slot, from, 1 - edge);
         }
     }
+  
+  for(unsigned c = 0; c < ncols && c < 2; c++)
+    {
+      ghost_depth[c] = NGHOSTS;
+      stale_ghosts[(memory + index - c) % memory] = false;
+    }
+}
+
+template <typename T>
+void KPM_Vector <T, 2>::refresh_ghosts() {
+  // Exchanges the ghosts of the current column if they were left out of date (see invalidate_ghosts)
+  if(stale_ghosts[index])
+    Exchange_Boundaries();
 }
 
 template <typename T>
@@ -668,22 +747,22 @@ void KPM_Vector <T, 2>::empty_ghosts(int mem_index) {
   for(long  io = 0; io < (long) r.Ld[2]; io++)
     for(long i0 = 0; i0 < (long) r.Ld[0]; i0++)
       for(int d = 0; d < NGHOSTS; d++)
-        v(x.set({i0,(long) d,io}).index, mem_index) *= 0;
+        v.col(mem_index).segment(x.set({i0,(long) d,io}).index * NBlock, NBlock) *= 0;
 
   for(long  io = 0; io < (long) r.Ld[2]; io++)
     for(long i0 = 0; i0 < (long) r.Ld[0]; i0++)
       for(int d = 0; d < NGHOSTS; d++)
-        v(x.set({i0, (long) (r.Ld[1] - 1 - d),io}).index, mem_index) *= 0;
+        v.col(mem_index).segment(x.set({i0, (long) (r.Ld[1] - 1 - d),io}).index * NBlock, NBlock) *= 0;
   
   for(long  io = 0; io < (long) r.Ld[2]; io++)
     for(long i1 = 0; i1 < (long) r.Ld[1]; i1++)
       for(int d = 0; d < NGHOSTS; d++)
-        v(x.set({(long) d,i1,io}).index, mem_index) *= 0;
+        v.col(mem_index).segment(x.set({(long) d,i1,io}).index * NBlock, NBlock) *= 0;
 
   for(long  io = 0; io < (long) r.Ld[2]; io++)
     for(long i1 = 0; i1 < (long) r.Ld[1]; i1++)
       for(int d = 0; d < NGHOSTS; d++)
-        v(x.set({(long) (r.Ld[0] - 1 - d),i1,io}).index, mem_index) *= 0;
+        v.col(mem_index).segment(x.set({(long) (r.Ld[0] - 1 - d),i1,io}).index * NBlock, NBlock) *= 0;
 
 }
 
@@ -696,16 +775,140 @@ void KPM_Vector<T,2>::Multiply() {
   
   unsigned i = 0;
   /*
-    Mosaic Multiplication using a TILE of TILE x TILE
-    Right Now We expect that both ld[0] and ld[1]  are multiple of TILE
+    Mosaic Multiplication using tiles of r.tile x r.tile
+    Right Now We expect that both ld[0] and ld[1]  are multiple of r.tile
     MULT = 0 : For the case of the Velocity/Hamiltonian
     MULT = 1 : For the case of the KPM_iteration
   */
+  light_cone_step();
+  const bool local = deferred && s_step && !cone_inside;
+  if(local && ghost_depth[0] == 0)
+    Exchange_Boundaries(MULT + 1);          // The recursion also needs the ghosts of the previous column
+  else if(!local && !cone_inside && ghost_depth[0] < NGHOSTS)
+    Exchange_Boundaries();                  // Ghosts left out of date by Velocity or invalidate_ghosts
+  // The new ghosts are exact up to one layer less than the ones they are computed from
+  const unsigned depth = (!local ? 0 : MULT == 1 ? std::min(ghost_depth[0] - 1, ghost_depth[1]) : ghost_depth[0] - 1);
+  
   inc_index();
   phi0 = v.col(index).data();
   phiM1 = v.col((memory + index - 1) % memory ).data();
   phiM2 = v.col((memory + index - 2) % memory ).data();
-  KPM_MOTOR<MULT, false>(phi0, phiM1, phiM2, i);
+  // Without magnetic field all the Peierls phases are 1 and KPM_MOTOR skips them
+  if(r.MagneticField != 0)
+    KPM_MOTOR<MULT, false, true>(phi0, phiM1, phiM2, i);
+  else
+    KPM_MOTOR<MULT, false, false>(phi0, phiM1, phiM2, i);
+  
+  if(cone_inside)
+    ghost_depth[0] = NGHOSTS;               // All the ghosts are still zero
+  else if(local)
+    mult_ghosts<MULT>(depth);
+  else
+    Exchange_Boundaries();
+}
+
+template <typename T>
+template <unsigned MULT> 
+void KPM_Vector<T,2>::Multiply(const T * bra, Eigen::Matrix<typename accumulator_type<T>::type, -1, 2> & mu) {
+  /*
+    Multiply<MULT>() that also returns the products over the interior of the domain
+       mu(ib, 0) = <bra_ib|phiM1_ib>      mu(ib, 1) = <bra_ib|phi0_ib>
+    where bra is a column with the same layout as v, or phiM1 itself when bra is null.
+    The products are accumulated in accumulator_type<T>, double precision for float vectors,
+    and the sums over the rows are compensated, so that they keep their digits on large samples.
+    The ghosts are left out, so the bra does not need to have them emptied.
+    KPM_MOTOR takes the products tile by tile, saving a sweep over the vectors, unless
+    structural disorder may still change a tile after it has been computed.
+  */
+  mu.setZero(NBlock, 2);
+  dot_err.setZero(NBlock, 2);
+  dot_bra = bra;
+  dot_mu = (h.hd.empty() ? mu.data() : nullptr);
+  Multiply<MULT>();
+  dot_mu = nullptr;
+  
+  if(!h.hd.empty())
+    for(std::size_t io = 0; io < r.Orb; io++)
+      for(std::size_t i1 = NGHOSTS; i1 < r.Ld[1] - NGHOSTS; i1++)
+        {
+          const std::size_t j = io * x.basis[2] + i1 * std + NGHOSTS;
+          this->dot_row((bra == nullptr ? phiM1 : bra) + j * NBlock, phiM1 + j * NBlock, phi0 + j * NBlock, r.ld[0], mu.data(), dot_err.data());
+        }
+  mu += dot_err;
+}
+
+template <typename T>
+template <unsigned MULT> 
+void KPM_Vector<T,2>::mult_ghosts(unsigned depth) {
+  /*
+    Computes the first depth ghost layers next to the interior, in the same way as the
+    neighbouring domain computes them, so that the exchange of the boundaries can be skipped.
+    Ghosts on open boundaries are always zero and are left alone.
+  */
+  ghost_depth[0] = depth;
+  if(depth == 0)
+    return;
+  
+  const std::size_t b0 = (r.boundary[0][0] ? NGHOSTS - depth : NGHOSTS), e0 = r.Ld[0] - NGHOSTS + (r.boundary[0][1] ? depth : 0);
+  const std::size_t b1 = (r.boundary[1][0] ? NGHOSTS - depth : NGHOSTS), e1 = r.Ld[1] - NGHOSTS + (r.boundary[1][1] ? depth : 0);
+  
+  for(std::size_t io = 0; io < r.Orb; io++)
+    {
+      const unsigned nhop = h.hr.NHoppings(io);
+      const int address = h.Anderson_orb_address[io];
+      const T * t = hoppings + h.hr.phase_offset[io];
+      for(unsigned ib = 0; ib < nhop; ib++)
+        row_distances[ib] = h.hr.distance(ib, io) * std::ptrdiff_t(NBlock);
+      
+      for(std::size_t i1 = b1; i1 < e1; i1++)
+        {
+          // Whole rows in the ghosts of a[1], the two sides of the interior otherwise
+          std::size_t segments[2][2] = {{b0, e0}, {e0, e0}};
+          if(i1 >= NGHOSTS && i1 < r.Ld[1] - NGHOSTS)
+            {
+              segments[0][1] = NGHOSTS;
+              segments[1][0] = r.Ld[0] - NGHOSTS;
+            }
+          
+          for(unsigned sg = 0; sg < 2; sg++)
+            {
+              const std::size_t j = io * x.basis[2] + i1 * std + segments[sg][0], n = segments[sg][1] - segments[sg][0];
+              if(n == 0)
+                continue;
+              
+              const value_type * U = nullptr;
+              if(address == -1)
+                std::fill_n(row_onsite.begin(), n * NBlock, h.U_Orbital.at(io));
+              else if(address >= 0 && h.Anderson_on_the_fly)
+                h.Anderson_row(row_onsite.data(), address, j - io * r.Nd, n, NBlock);
+              else if(address >= 0)
+                for(std::size_t k = 0; k < n; k++)
+                  std::fill_n(row_onsite.begin() + k * NBlock, NBlock, h.U_Anderson.at(address * r.Nd + j - io * r.Nd + k));
+              if(address != -2)
+                U = row_onsite.data();
+              
+              this->template stencil_row<MULT>(phi0 + j * NBlock, phiM1 + j * NBlock, phiM2 + j * NBlock, n * NBlock, true,
+                                               U, nhop, t, row_distances.data());
+            }
+        }
+    }
+}
+
+template <typename T>
+void KPM_Vector<T,2>::defer_exchange(bool defer) {
+  /*
+    While deferred, Multiply exchanges the ghosts of the last two columns once every NGHOSTS
+    steps and recomputes them locally in between, whenever the Hamiltonian allows it (s_step).
+    Only the interior of the columns is then guaranteed to be up to date, which is enough for
+    the products with vectors whose ghosts are empty. Ending the deferred mode exchanges the
+    current column if needed. Must be called by all the threads, which agree on s_step.
+  */
+  if(defer && !s_step){
+    verbose_message("The exchange of the ghosts is not deferred with a magnetic field, structural disorder or vacancies\n");
+  }
+  if(!defer && ghost_depth[0] < NGHOSTS)
+    Exchange_Boundaries();
+  deferred = defer;
 }
 
 
@@ -734,6 +937,17 @@ template void KPM_Vector<std::complex<float> ,2u>::Multiply<1u>();
 template void KPM_Vector<std::complex<double> ,2u>::Multiply<1u>();
 template void KPM_Vector<std::complex<long double> ,2u>::Multiply<1u>();
 
-
-
+template void KPM_Vector<float ,2u>::Multiply<0u>(const float *, Eigen::Matrix<double, -1, 2> &);
+template void KPM_Vector<double ,2u>::Multiply<0u>(const double *, Eigen::Matrix<double, -1, 2> &);
+template void KPM_Vector<long double ,2u>::Multiply<0u>(const long double *, Eigen::Matrix<long double, -1, 2> &);
+template void KPM_Vector<std::complex<float> ,2u>::Multiply<0u>(const std::complex<float> *, Eigen::Matrix<std::complex<double>, -1, 2> &);
+template void KPM_Vector<std::complex<double> ,2u>::Multiply<0u>(const std::complex<double> *, Eigen::Matrix<std::complex<double>, -1, 2> &);
+template void KPM_Vector<std::complex<long double> ,2u>::Multiply<0u>(const std::complex<long double> *, Eigen::Matrix<std::complex<long double>, -1, 2> &);
+
+template void KPM_Vector<float ,2u>::Multiply<1u>(const float *, Eigen::Matrix<double, -1, 2> &);
+template void KPM_Vector<double ,2u>::Multiply<1u>(const double *, Eigen::Matrix<double, -1, 2> &);
+template void KPM_Vector<long double ,2u>::Multiply<1u>(const long double *, Eigen::Matrix<long double, -1, 2> &);
+template void KPM_Vector<std::complex<float> ,2u>::Multiply<1u>(const std::complex<float> *, Eigen::Matrix<std::complex<double>, -1, 2> &);
+template void KPM_Vector<std::complex<double> ,2u>::Multiply<1u>(const std::complex<double> *, Eigen::Matrix<std::complex<double>, -1, 2> &);
+template void KPM_Vector<std::complex<long double> ,2u>::Multiply<1u>(const std::complex<long double> *, Eigen::Matrix<std::complex<long double>, -1, 2> &);
 
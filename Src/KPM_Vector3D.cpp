@@ -30,8 +30,8 @@ class Simulation;
 // VER o que tenho que por aqui: tile, tile_ghosts, transf_max, x, std
 
 template <typename T>
-KPM_Vector<T,3u>::KPM_Vector(int mem, Simulation<T,3u> & sim) :
-  KPM_VectorBasis<T,3u>(mem, sim),
+KPM_Vector<T,3u>::KPM_Vector(int mem, Simulation<T,3u> & sim, unsigned nblock) :
+  KPM_VectorBasis<T,3u>(mem, sim, nblock),
   tile{1, sim.r.Ld[0], sim.r.Ld[0] * sim.r.Ld[1] },
   transf_max{{NGHOSTS, sim.r.ld[1], sim.r.ld[2]} , { sim.r.Ld[0] , NGHOSTS, sim.r.ld[2]} , {sim.r.Ld[0], sim.r.Ld[1], NGHOSTS} },
   r(sim.r) , h(sim.h) //,  x(sim.r.Ld)
@@ -43,14 +43,14 @@ KPM_Vector<T,3u>::KPM_Vector(int mem, Simulation<T,3u> & sim) :
 
     std::size_t max_0, max_1;
     
-    mult_t1_ghost_cor = new   T**[r.Orb];
-    
-    for(unsigned io = 0; io < r.Orb; io++)
-      {
-        mult_t1_ghost_cor[io] = new T*[h.hr.NHoppings(io)];
-        for(unsigned ib = 0; ib < h.hr.NHoppings(io); ib++)
-          mult_t1_ghost_cor[io][ib] = new T[TILE];
-      }
+    // One slice of the scratch rows for each thread of the team
+    row_distances.resize(r.team * h.hr.NHoppings.maxCoeff());
+    row_onsite.resize(r.team * r.Ld[0] * NBlock);
+    // The ghosts can be recomputed locally when all the terms of the Hamiltonian are translation invariant
+    // functions of the global position: no magnetic field, no structural disorder and no vacancies
+    s_step = (r.MagneticField == 0 && h.hd.empty() && h.hV.concentration.empty());
+    dot_bra = nullptr;
+    dot_mu = nullptr;
 
     for(unsigned d = 0; d < D; d++)
       for(unsigned b = 0; b < 2; b++)
@@ -134,8 +134,10 @@ KPM_Vector<T,3u>::KPM_Vector(int mem, Simulation<T,3u> & sim) :
           block[d][b] = x.set_coord( int(r.thread_id) ).add(dist).index;
         }
 
+    // The vector starts random, but the random vectors of the traces are numbered from the first
+    // one used, whatever the number and the blocks of the vectors constructed before
     initiate_vector();
-
+    simul.rnd.vectors -= NBlock;
   }
 
 
@@ -143,14 +145,6 @@ template <typename T>
 KPM_Vector <T, 3u>::~KPM_Vector(void) {
   
   
-  for(unsigned io = 0; io < r.Orb;io++)
-    {
-      for(unsigned ib = 0; ib < h.hr.NHoppings(io); ib++)
-        delete mult_t1_ghost_cor[io][ib];
-      delete mult_t1_ghost_cor[io];
-    }  
-  delete mult_t1_ghost_cor;
-  
   for(unsigned d = 0; d < D; d++)
     for(unsigned b = 0; b < 2; b++)
       {
@@ -163,19 +157,39 @@ KPM_Vector <T, 3u>::~KPM_Vector(void) {
 template <typename T>
 void KPM_Vector <T, 3u>::initiate_vector()
 {  
+  initiate_vector(NBlock);
+}
+
+template <typename T>
+void KPM_Vector <T, 3u>::initiate_vector(unsigned nvec)
+{  
+  // The first nvec vectors of the block are random, the remaining ones are set to zero
+  // The random numbers are keyed by the global site index, so they do not depend on the domain decomposition
   index = 0;
-  Coordinates<std::size_t, 4> x(r.Ld);
-  for(std::size_t io = 0; io < r.Orb; io++)
-    for(std::size_t i2 = NGHOSTS; i2 < r.Ld[2] - NGHOSTS; i2++)
-      for(std::size_t i1 = NGHOSTS; i1 < r.Ld[1] - NGHOSTS; i1++)
-        for(std::size_t i0 = NGHOSTS; i0 < r.Ld[0] - NGHOSTS; i0++)
-          v(x.set({i0,i1,i2,io}).index, index) = simul.rnd.init()/static_cast<value_type>(sqrt(value_type(r.Sizet - r.SizetVacancies)));
+  const value_type norm = static_cast<value_type>(sqrt(value_type(r.Sizet - r.SizetVacancies)));
+  Coordinates<std::size_t, 4> x(r.Ld), z(r.Lt);
+  for(unsigned ib = 0; ib < NBlock; ib++)
+    for(std::size_t io = 0; io < r.Orb; io++)
+      for(std::size_t i2 = NGHOSTS; i2 < r.Ld[2] - NGHOSTS; i2++)
+        for(std::size_t i1 = NGHOSTS; i1 < r.Ld[1] - NGHOSTS; i1++)
+          {
+            x.set({std::size_t(NGHOSTS),i1,i2,io});
+            if(ib < nvec)
+              {
+                r.convertCoordinates(z, x);
+                simul.rnd.init_row(&v(x.index * NBlock + ib, index), NBlock, z.index, r.ld[0], simul.rnd.vectors + ib, norm);
+              }
+            else
+              for(std::size_t i0 = 0; i0 < r.ld[0]; i0++)
+                v((x.index + i0) * NBlock + ib, index) = 0.;
+          }
+  simul.rnd.vectors += nvec;
   
   for(unsigned i = 0; i < r.NStr; i++)
     {
       auto & vv = h.hV.position.at(i); 
       for(unsigned j = 0; j < vv.size(); j++)
-        v(vv.at(j), index ) = 0. ;
+        v.col(index).segment(vv.at(j) * NBlock, NBlock).setZero();
     }
   
 }
@@ -361,8 +375,8 @@ void KPM_Vector <T, 3>::empty_ghosts(int mem_index) {
       for(long i1 = 0; i1 <  r.Ld[1]; i1++)
         for(long i0 = 0; i0 < NGHL; i0++)
           {
-            v(x.set({i0,i1,i2,io}).index, mem_index) *= 0;
-            v(x.set({r.Ld[0] - 1 - i0, i1, i2, io}).index, mem_index) *= 0;
+            v.col(mem_index).segment(x.set({i0,i1,i2,io}).index * NBlock, NBlock) *= 0;
+            v.col(mem_index).segment(x.set({r.Ld[0] - 1 - i0, i1, i2, io}).index * NBlock, NBlock) *= 0;
           }
 
   // perpendicular to y axis
@@ -372,8 +386,8 @@ void KPM_Vector <T, 3>::empty_ghosts(int mem_index) {
       for(long i1 = 0; i1 < NGHL; i1++)
         for(long i0 = 0; i0 < r.Ld[0]; i0++)
           {
-            v(x.set({i0,i1,i2,io}).index, mem_index) *= 0;
-            v(x.set({i0,r.Ld[1] - 1 -  i1, i2, io}).index, mem_index) *= 0;
+            v.col(mem_index).segment(x.set({i0,i1,i2,io}).index * NBlock, NBlock) *= 0;
+            v.col(mem_index).segment(x.set({i0,r.Ld[1] - 1 -  i1, i2, io}).index * NBlock, NBlock) *= 0;
           }
   
   // perpendicular to y axis
@@ -383,8 +397,8 @@ void KPM_Vector <T, 3>::empty_ghosts(int mem_index) {
       for(long i1 = 0; i1 < r.Ld[1]; i1++)
         for(long i0 = 0; i0 <  r.Ld[0]; i0++)
           {
-            v(x.set({i0,i1,i2,io}).index, mem_index) *= 0;
-            v(x.set({i0,i1,r.Ld[2] - 1 - i2, io}).index, mem_index) *= 0;
+            v.col(mem_index).segment(x.set({i0,i1,i2,io}).index * NBlock, NBlock) *= 0;
+            v.col(mem_index).segment(x.set({i0,i1,r.Ld[2] - 1 - i2, io}).index * NBlock, NBlock) *= 0;
           }
 }
 
@@ -463,67 +477,220 @@ void KPM_Vector <T, 3>::Multiply() {
   
   unsigned i = 0;
   /*
-    Mosaic Multiplication using a TILE of TILE x TILE
-    Right Now We expect that both ld[0] and ld[1]  are multiple of TILE
+    Mosaic Multiplication using tiles of r.tile x r.tile
+    Right Now We expect that both ld[0] and ld[1]  are multiple of r.tile
     MULT = 0 : For the case of the Velocity/Hamiltonian
     MULT = 1 : For the case of the KPM_iteration
   */
   
+  light_cone_step();
+  const bool local = deferred && s_step && !cone_inside;
+  if(local && ghost_depth[0] == 0)
+    Exchange_Boundaries(MULT + 1);          // The recursion also needs the ghosts of the previous column
+  else if(!local && !cone_inside && ghost_depth[0] < NGHOSTS)
+    Exchange_Boundaries();                  // Ghosts left out of date by Velocity or invalidate_ghosts
+  // The new ghosts are exact up to one layer less than the ones they are computed from
+  const unsigned depth = (!local ? 0 : MULT == 1 ? std::min(ghost_depth[0] - 1, ghost_depth[1]) : ghost_depth[0] - 1);
+  
   inc_index();
   phi0 = v.col(index).data();
   phiM1 = v.col((memory + index - 1) % memory ).data();
   phiM2 = v.col((memory + index - 2) % memory ).data();
-  KPM_MOTOR<MULT, false>(phi0, phiM1, phiM2, i);
+  // Without magnetic field all the Peierls phases are 1 and KPM_MOTOR skips them
+  if(r.MagneticField != 0)
+    KPM_MOTOR<MULT, false, true>(phi0, phiM1, phiM2, i);
+  else
+    KPM_MOTOR<MULT, false, false>(phi0, phiM1, phiM2, i);
+  
+  if(cone_inside)
+    ghost_depth[0] = NGHOSTS;               // All the ghosts are still zero
+  else if(local)
+    mult_ghosts<MULT>(depth);
+  else
+    Exchange_Boundaries();
+}
 
+template <typename T>
+template <unsigned MULT> 
+void KPM_Vector<T,3>::Multiply(const T * bra, Eigen::Matrix<typename accumulator_type<T>::type, -1, 2> & mu) {
+  // See KPM_Vector<T,2>::Multiply(bra, mu)
+  mu.setZero(NBlock, 2);
+  dot_err.setZero(NBlock, 2);
+  dot_bra = bra;
+  dot_mu = (h.hd.empty() ? mu.data() : nullptr);
+  Multiply<MULT>();
+  dot_mu = nullptr;
+  
+  if(!h.hd.empty())
+    {
+      Coordinates<std::size_t, D + 1> x(r.Ld);
+      for(std::size_t io = 0; io < r.Orb; io++)
+        for(std::size_t i2 = NGHOSTS; i2 < r.Ld[2] - NGHOSTS; i2++)
+          for(std::size_t i1 = NGHOSTS; i1 < r.Ld[1] - NGHOSTS; i1++)
+            {
+              const std::size_t j = x.set({std::size_t(NGHOSTS), i1, i2, io}).index;
+              this->dot_row((bra == nullptr ? phiM1 : bra) + j * NBlock, phiM1 + j * NBlock, phi0 + j * NBlock, r.ld[0], mu.data(), dot_err.data());
+            }
+    }
+  mu += dot_err;
+}
+
+template <typename T>
+template <unsigned MULT> 
+void KPM_Vector<T,3>::mult_ghosts(unsigned depth) {
+  /*
+    Computes the first depth ghost layers next to the interior, in the same way as the
+    neighbouring domain computes them, so that the exchange of the boundaries can be skipped.
+    Ghosts on open boundaries are always zero and are left alone.
+  */
+  ghost_depth[0] = depth;
+  if(depth == 0)
+    return;
+  
+  std::size_t b[3], e[3];
+  for(unsigned d = 0; d < 3; d++)
+    {
+      b[d] = (r.boundary[d][0] ? NGHOSTS - depth : NGHOSTS);
+      e[d] = r.Ld[d] - NGHOSTS + (r.boundary[d][1] ? depth : 0);
+    }
+  
+  for(std::size_t io = 0; io < r.Orb; io++)
+    {
+      const unsigned nhop = h.hr.NHoppings(io);
+      const int address = h.Anderson_orb_address[io];
+      const T * t = hoppings + h.hr.phase_offset[io];
+      for(unsigned ib = 0; ib < nhop; ib++)
+        row_distances[ib] = h.hr.distance(ib, io) * std::ptrdiff_t(NBlock);
+      
+      for(std::size_t i2 = b[2]; i2 < e[2]; i2++)
+        for(std::size_t i1 = b[1]; i1 < e[1]; i1++)
+          {
+            // Whole rows in the ghosts of a[1] and a[2], the two sides of the interior otherwise
+            std::size_t segments[2][2] = {{b[0], e[0]}, {e[0], e[0]}};
+            if(i1 >= NGHOSTS && i1 < r.Ld[1] - NGHOSTS && i2 >= NGHOSTS && i2 < r.Ld[2] - NGHOSTS)
+              {
+                segments[0][1] = NGHOSTS;
+                segments[1][0] = r.Ld[0] - NGHOSTS;
+              }
+            
+            for(unsigned sg = 0; sg < 2; sg++)
+              {
+                const std::size_t j = io * r.Nd + i2 * tile[2] + i1 * tile[1] + segments[sg][0], n = segments[sg][1] - segments[sg][0];
+                if(n == 0)
+                  continue;
+                
+                const value_type * U = nullptr;
+                if(address == -1)
+                  std::fill_n(row_onsite.begin(), n * NBlock, h.U_Orbital.at(io));
+                else if(address >= 0 && h.Anderson_on_the_fly)
+                  h.Anderson_row(row_onsite.data(), address, j - io * r.Nd, n, NBlock);
+                else if(address >= 0)
+                  for(std::size_t k = 0; k < n; k++)
+                    std::fill_n(row_onsite.begin() + k * NBlock, NBlock, h.U_Anderson.at(address * r.Nd + j - io * r.Nd + k));
+                if(address != -2)
+                  U = row_onsite.data();
+                
+                this->template stencil_row<MULT>(phi0 + j * NBlock, phiM1 + j * NBlock, phiM2 + j * NBlock, n * NBlock, true,
+                                                 U, nhop, t, row_distances.data());
+              }
+          }
+    }
+}
+
+template <typename T>
+void KPM_Vector<T,3>::defer_exchange(bool defer) {
+  // See KPM_Vector<T,2>::defer_exchange
+  if(defer && !s_step){
+    verbose_message("The exchange of the ghosts is not deferred with a magnetic field, structural disorder or vacancies\n");
+  }
+  if(!defer && ghost_depth[0] < NGHOSTS)
+    Exchange_Boundaries();
+  deferred = defer;
 }
 
 template <typename T>
 void KPM_Vector <T, 3>::Velocity(T * phi0,T * phiM1, unsigned axis) {
-  KPM_MOTOR<0u, true>(phi0, phiM1, phiM1, axis);
+  if(r.MagneticField != 0)
+    KPM_MOTOR<0u, true, true>(phi0, phiM1, phiM1, axis);
+  else
+    KPM_MOTOR<0u, true, false>(phi0, phiM1, phiM1, axis);
+  invalidate_ghosts();
 }
 
 template <typename T>
 void KPM_Vector <T, 3>::Velocity(T * phi0,T * phiM1, int axis) {
-  KPM_MOTOR<0u, true>(phi0, phiM1, phiM1, axis);
+  if(r.MagneticField != 0)
+    KPM_MOTOR<0u, true, true>(phi0, phiM1, phiM1, axis);
+  else
+    KPM_MOTOR<0u, true, false>(phi0, phiM1, phiM1, axis);
+  invalidate_ghosts();
 }
 
 
 
 template <typename T>
 void KPM_Vector <T, 3>::Exchange_Boundaries() {
+  Exchange_Boundaries(1);
+}
+
+template <typename T>
+void KPM_Vector <T, 3>::Exchange_Boundaries(unsigned ncols) {
   /*
-    I have four boundaries to exchange with the other threads.
-    First I will copy the lines along the a[1] direction to a consecutive shared vector
+    I have six boundaries to exchange with the other threads.
+    The edges of each direction are packed in a slot of Global.ghosts that belongs to this thread,
+    from where the neighbours copy them to their ghosts. Each thread only waits for its own
+    neighbours (see GLOBAL_VARIABLES::send_ghosts). The edges along a[1] and a[2] carry the
+    corners received along the previous directions, so the directions go one after the other.
+    A domain that is its own neighbour copies its edges straight to its ghosts.
+    The columns index, index - 1, ..., index - ncols + 1 are exchanged together
   */
   
-#pragma omp barrier    
-  Coordinates<std::size_t,4u> x(r.Ld), z(r.Lt);
-  T  *phi = v.col(index).data();
-  
-   
   for(unsigned d = 0; d < 3; d++)
     {
-      std::size_t BSize = r.Orb * transf_max[d][0] *transf_max[d][1] * transf_max[d][2];
+      std::size_t CSize = r.Orb * transf_max[d][0] *transf_max[d][1] * transf_max[d][2] * NBlock;
+      std::size_t BSize = ncols * CSize;
+      std::size_t slot  = r.thread_id * D + d;
+
+      if(r.nd[d] == 1)
+        {
+          for(std::size_t co = 0; co < ncols * r.Orb; co++)
+            {
+              const std::size_t c = co / r.Orb, io = co % r.Orb;
+              T  *phi = v.col((memory + index - c) % memory).data();
+              for(unsigned edge = 0; edge < 2; edge++)
+                for(std::size_t i2 = 0; i2 < transf_bound[d][edge][2]; i2++)
+                  for(std::size_t i1 = 0; i1 < transf_bound[d][edge][1]; i1++)
+                    {
+                      std::size_t is = (MemIndBeg[d][edge][io]     + i2 * tile[2] + i1 * tile[1]) * NBlock;
+                      std::size_t ie = (MemIndEnd[d][1 - edge][io] + i2 * tile[2] + i1 * tile[1]) * NBlock;
+                      std::copy_n(phi + is, transf_bound[d][edge][0] * NBlock, phi + ie);
+                    }
+            }
+          continue;
+        }
       
-      T * ghosts_left = & simul.ghosts[0];
-      T * ghosts_right = & simul.ghosts[BSize];
+      T * ghosts_left = simul.Global.send_ghosts(slot, r.boundary[d]);
+      T * ghosts_right = ghosts_left + BSize;
 
-      for(std::size_t io = 0; io < r.Orb; io++)
+      // The columns are packed one after the other, each one taking CSize elements
+      for(std::size_t co = 0; co < ncols * r.Orb; co++)
         {
+          const std::size_t c = co / r.Orb, io = co % r.Orb;
+          T  *phi = v.col((memory + index - c) % memory).data();
           std::size_t il = MemIndBeg[d][0][io];
           std::size_t ir = MemIndBeg[d][1][io];
-          std::size_t irefPakLeft  = io *  transf_bound[d][0][2] * transf_bound[d][0][1] * transf_bound[d][0][0];
-          std::size_t irefPakRight = io *  transf_bound[d][1][2] * transf_bound[d][1][1] * transf_bound[d][1][0];
+          std::size_t irefPakLeft  = c * CSize + io *  transf_bound[d][0][2] * transf_bound[d][0][1] * transf_bound[d][0][0] * NBlock;
+          std::size_t irefPakRight = c * CSize + io *  transf_bound[d][1][2] * transf_bound[d][1][1] * transf_bound[d][1][0] * NBlock;
           
           // Copy Left Edge
           
           for(std::size_t i2 = 0; i2 < transf_bound[d][0][2]; i2++)
             for(std::size_t i1 = 0; i1 < transf_bound[d][0][1]; i1++)
               {
-                std::size_t iref = il + i2 * tile[2] + i1 * tile[1];
-                for(std::size_t i0 = 0; i0 < transf_bound[d][0][0]; i0++)
+                std::size_t iref = (il + i2 * tile[2] + i1 * tile[1]) * NBlock;
+                for(std::size_t i0 = 0; i0 < transf_bound[d][0][0] * NBlock; i0++)
                   ghosts_left[irefPakLeft + i0] = phi[iref + i0];
-                irefPakLeft += transf_bound[d][0][0];
+                irefPakLeft += transf_bound[d][0][0] * NBlock;
               }
           
           // Copy Right
@@ -531,103 +698,109 @@ void KPM_Vector <T, 3>::Exchange_Boundaries() {
           for(std::size_t i2 = 0; i2 < transf_bound[d][1][2]; i2++)
             for(std::size_t i1 = 0; i1 < transf_bound[d][1][1]; i1++)
               {
-                std::size_t iref = ir + i2 * tile[2] + i1 * tile[1];
-                for(std::size_t i0 = 0; i0 < transf_bound[d][1][0]; i0++)
+                std::size_t iref = (ir + i2 * tile[2] + i1 * tile[1]) * NBlock;
+                for(std::size_t i0 = 0; i0 < transf_bound[d][1][0] * NBlock; i0++)
                   ghosts_right[irefPakRight + i0] = phi[iref + i0];
-                irefPakRight += transf_bound[d][1][0];
+                irefPakRight += transf_bound[d][1][0] * NBlock;
               }
           
 	}
-      // Copy the boundaries to the shared memory
-      std::copy( ghosts_left, ghosts_left + 2*BSize, simul.Global.ghosts.begin() + 2*BSize * r.thread_id );	  
-#pragma omp barrier
-      auto neigh_left = simul.Global.ghosts.begin() + 2 * block[d][0] * BSize;
-      auto neigh_right  = simul.Global.ghosts.begin() + 2 * block[d][1] * BSize;
-      std::copy(neigh_right,         neigh_right + BSize , ghosts_right );     // From the left to the right
-      std::copy(neigh_left + BSize,  neigh_left + 2*BSize, ghosts_left  )  ;   // From the right to the left
-      
-#pragma omp barrier	
-      for(std::size_t io = 0; io < r.Orb; io++)
+      simul.Global.sent_ghosts(slot);
+
+      // The left neighbour sends its right edge and the right neighbour its left edge
+      for(unsigned edge = 0; edge < 2; edge++)
         {
-          std::size_t il = MemIndEnd[d][0][io];
-          std::size_t ir = MemIndEnd[d][1][io];
-          std::size_t irefPakLeft  = io *  transf_bound[d][0][2] * transf_bound[d][0][1] * transf_bound[d][0][0];
-          std::size_t irefPakRight = io *  transf_bound[d][1][2] * transf_bound[d][1][1] * transf_bound[d][1][0];
-          
-          
-          // Copy Left Edge
-          
-          for(std::size_t i2 = 0; i2 < transf_bound[d][0][2]; i2++)
-            for(std::size_t i1 = 0; i1 < transf_bound[d][0][1]; i1++)
-              {
-                std::size_t iref = il + i2 * tile[2] + i1 * tile[1];
-                for(std::size_t i0 = 0; i0 < transf_bound[d][0][0]; i0++)
-                  phi[iref + i0] = ghosts_left[irefPakLeft + i0];
-                irefPakLeft += transf_bound[d][0][0];
-              }
-          
-          // Copy Right
-          
-          for(std::size_t i2 = 0; i2 < transf_bound[d][1][2]; i2++)
-            for(std::size_t i1 = 0; i1 < transf_bound[d][1][1]; i1++)
-              {
-                std::size_t iref = ir + i2 * tile[2] + i1 * tile[1];
-                for(std::size_t i0 = 0; i0 < transf_bound[d][1][0]; i0++)
-                  phi[iref+i0] = ghosts_right[irefPakRight + i0];
-                irefPakRight += transf_bound[d][1][0];
-              }
+          if(!r.boundary[d][edge])
+            continue;
+          std::size_t from = block[d][edge] * D + d;
+          const T * ghosts = simul.Global.receive_ghosts(slot, from) + (1 - edge) * BSize;
+          for(std::size_t co = 0; co < ncols * r.Orb; co++)
+            {
+              const std::size_t c = co / r.Orb, io = co % r.Orb;
+              T  *phi = v.col((memory + index - c) % memory).data();
+              std::size_t ie = MemIndEnd[d][edge][io];
+              std::size_t irefPak = c * CSize + io *  transf_bound[d][edge][2] * transf_bound[d][edge][1] * transf_bound[d][edge][0] * NBlock;
+              
+              for(std::size_t i2 = 0; i2 < transf_bound[d][edge][2]; i2++)
+                for(std::size_t i1 = 0; i1 < transf_bound[d][edge][1]; i1++)
+                  {
+                    std::size_t iref = (ie + i2 * tile[2] + i1 * tile[1]) * NBlock;
+                    for(std::size_t i0 = 0; i0 < transf_bound[d][edge][0] * NBlock; i0++)
+                      phi[iref + i0] = ghosts[irefPak + i0];
+                    irefPak += transf_bound[d][edge][0] * NBlock;
+                  }
+            }
+          simul.Global.received_ghosts(slot, from, 1 - edge);
         }
     }
-
-} 
-
-template <typename T>
-void inline KPM_Vector <T, 3>::mult_regular_hoppings(const  std::size_t & ind_i, const  std::size_t & io)
-{
   
-  std::size_t count;
-  const std::size_t ind_f = ind_i + TILE * tile[2];
-  // Hoppings
-  for(unsigned ib = 0; ib < h.hr.NHoppings(io); ib++)
+  for(unsigned c = 0; c < ncols && c < 2; c++)
     {
-      const std::ptrdiff_t d1 = h.hr.distance(ib, io);
-      count = 0;
-      for( std::size_t j2 = ind_i; j2 < ind_f; j2 += tile[2] )
-        {
-          const T t1 = mult_t1_ghost_cor[io][ib][count++];
-          const std::size_t std = tile[1], j2M = j2 + std * TILE;
-          for(std::size_t j1 = j2; j1 < j2M; j1 += std )
-            for(std::size_t j0 = j1; j0 < j1 + TILE ; j0++)
-              phi0[j0] += t1 * phiM1[j0 + d1];								
-        }
+      ghost_depth[c] = NGHOSTS;
+      stale_ghosts[(memory + index - c) % memory] = false;
     }
-  
 }
 
+template <typename T>
+void KPM_Vector <T, 3>::refresh_ghosts() {
+  // Exchanges the ghosts of the current column if they were left out of date (see invalidate_ghosts)
+  if(stale_ghosts[index])
+    Exchange_Boundaries();
+} 
 
 template <typename T>
-template < unsigned MULT> 
-void inline KPM_Vector <T, 3>::mult_local_disorder(const  std::size_t & ind_i, const  std::size_t & io)
+template <unsigned MULT, bool VELOCITY, bool FIELD> 
+void inline KPM_Vector <T, 3>::mult_tile(const  std::size_t & ind_i, const  std::size_t & io, std::size_t row, bool init, unsigned it)
 {
-  
-  const std::size_t ind_f = ind_i + TILE * tile[2];
+  // Local energy and regular hoppings of the orbital io, applied row by row in a single pass
+  // it is the thread of the team, which has its own slice of row_distances and row_onsite
+  const std::size_t ind_f = ind_i + r.tile * tile[2];
+  const unsigned nhop = h.hr.NHoppings(io);
   const std::ptrdiff_t dd = (h.Anderson_orb_address[io] - std::ptrdiff_t(io))*r.Nd;
-  // Anderson disorder
-  if( h.Anderson_orb_address[io] >= 0)
+  const value_type * U = nullptr;
+  std::ptrdiff_t * distances = row_distances.data() + it * (row_distances.size() / r.team);
+  value_type * onsite = row_onsite.data() + it * (row_onsite.size() / r.team);
+  
+  for(unsigned ib = 0; ib < nhop; ib++)
+    distances[ib] = h.hr.distance(ib, io) * std::ptrdiff_t(NBlock);
+  
+  if(!VELOCITY && h.Anderson_orb_address[io] == - 1)
     {
-      for(std::size_t j2 = ind_i; j2 < ind_f; j2 += tile[2] )
-        for(std::size_t j1 = j2; j1 < j2 + tile[1] * TILE; j1 += tile[1] )
-          for(std::size_t j0 = j1; j0 < j1 + TILE ; j0++)
-            phi0[j0] += value_type(MULT + 1) * phiM1[j0] * h.U_Anderson.at(j0 + dd);
+      std::fill_n(onsite, r.tile * NBlock, h.U_Orbital.at(io));
+      U = onsite;
     }
-  else if (h.Anderson_orb_address[io] == - 1)
+  
+  for( std::size_t j2 = ind_i; j2 < ind_f; j2 += tile[2] )
     {
-      for(std::size_t j2 = ind_i; j2 < ind_f; j2 += tile[2] )
-        for(std::size_t j1 = j2; j1 < j2 + tile[1] * TILE; j1 += tile[1] )
-          for(std::size_t j0 = j1; j0 < j1 + TILE ; j0++)
-            phi0[j0] += value_type(MULT + 1) * phiM1[j0] * h.U_Orbital.at(io);
+      // The Peierls phases only change from plane to plane
+      const T * t = hoppings + h.hr.phase_offset[io] + (FIELD ? row * nhop : 0);
+      row++;
+      
+      const std::size_t std = tile[1], j2M = j2 + std * r.tile;
+      for(std::size_t j1 = j2; j1 < j2M; j1 += std )
+        {
+          // Anderson disorder
+          if(!VELOCITY && h.Anderson_orb_address[io] >= 0)
+            {
+              if(h.Anderson_on_the_fly)
+                {
+                  h.Anderson_row(onsite, h.Anderson_orb_address[io], j1 - io * r.Nd, r.tile, NBlock);
+                  U = onsite;
+                }
+              else if(NBlock == 1)
+                U = &h.U_Anderson.at(j1 + dd);
+              else
+                {
+                  for(std::size_t i = 0; i < r.tile; i++)
+                    std::fill_n(onsite + i * NBlock, NBlock, h.U_Anderson.at(j1 + i + dd));
+                  U = onsite;
+                }
+            }
+          
+          this->template stencil_row<MULT>(phi0 + j1 * NBlock, phiM1 + j1 * NBlock, phiM2 + j1 * NBlock, r.tile * NBlock, init,
+                                           U, nhop, t, distances);
+        }
     }
-  
 }
 
 
@@ -636,21 +809,21 @@ template < unsigned MULT>
 void KPM_Vector <T, 3u>::initiate_stride(std::size_t & istr)
 {
   
-  const std::size_t Delta_2 = tile[2] * TILE, Delta_1 = tile[1] * TILE;
+  const std::size_t Delta_2 = tile[2] * r.tile, Delta_1 = tile[1] * r.tile;
   Coordinates<std::size_t, 4u> rStr(r.lStr);
   Coordinates<std::size_t, 4u> rLd(r.Ld);
   // Periodic component of the Hamiltonian + Anderson disorder
   rStr.set_coord(istr);
-  std::size_t i0 = rStr.coord[0] * TILE + NGHOSTS;
-  std::size_t i1 = rStr.coord[1] * TILE + NGHOSTS;
-  std::size_t i2 = rStr.coord[2] * TILE + NGHOSTS;
+  std::size_t i0 = rStr.coord[0] * r.tile + NGHOSTS;
+  std::size_t i1 = rStr.coord[1] * r.tile + NGHOSTS;
+  std::size_t i2 = rStr.coord[2] * r.tile + NGHOSTS;
   
   for(std::size_t io = 0; io < r.Orb; io++)
     {
       const std::size_t ind_i = rLd.set({i0,i1,i2,io}).index;
       for(std::size_t j2 = ind_i; j2 < ind_i + Delta_2; j2 += tile[2] )
         for(std::size_t j1 = j2; j1 < j2 + Delta_1; j1 += tile[1] )
-          for(std::size_t j0 = j1; j0 < j1 + TILE ; j0++)
+          for(std::size_t j0 = j1 * NBlock; j0 < (j1 + r.tile) * NBlock ; j0++)
             phi0[j0] = - value_type(MULT) * phiM2[j0];
     }
   
@@ -659,46 +832,53 @@ void KPM_Vector <T, 3u>::initiate_stride(std::size_t & istr)
 
 
 template <typename T>
-template < unsigned MULT,bool VELOCITY> 
-void KPM_Vector <T, 3>::build_regular_phases(int i2min, unsigned axis)
+template <unsigned MULT, bool VELOCITY, bool FIELD>
+void KPM_Vector <T, 3>::motor_tile(std::size_t istr, unsigned axis, unsigned it, accumulator * mu, accumulator * err)
 {
-
-  Coordinates<std::ptrdiff_t, D + 1>  global(r.Lt);
-  Coordinates<std::ptrdiff_t, D + 1>  local1(r.Ld);
-  Coordinates<std::ptrdiff_t, D + 1>     b3(r.lB3);    
-  Eigen::Map<Eigen::Matrix<std::ptrdiff_t,D, 1>> vee(b3.coord); // Column vector
+  // Stencil of the tile istr, done by the thread it of the team. The products are added to mu and err
+  Coordinates<std::size_t, D + 1> x(r.Ld);
+  const std::size_t i0 = istr % r.lStr[0] * r.tile + NGHOSTS;
+  const std::size_t i1 = istr / r.lStr[0] % r.lStr[1] * r.tile + NGHOSTS;
+  const std::size_t i2 = istr / r.lStr[0] / r.lStr[1] * r.tile + NGHOSTS;
   
+  // Tiles out of the light cone stay zero (see light_cone)
+  if(!VELOCITY && cone && !(cone_tiles[0][(i0 - NGHOSTS) / r.tile] && cone_tiles[1][(i1 - NGHOSTS) / r.tile] &&
+                            cone_tiles[2][(i2 - NGHOSTS) / r.tile]))
+    return;
   
-  for(unsigned io = 0; io < r.Orb; io++)
+  // Tiles that were not initialized in advance are initialized inside the stencil
+  const bool init = h.cross_mozaic.at(istr);
+  for(std::size_t io = 0; io < r.Orb; io++)
     {
-      r.convertCoordinates(global, local1.set({0,0,i2min,io}));      
+      const std::size_t ip = io * x.basis[3];
+      const std::size_t j0 = ip + i0 + i1 * tile[1] + i2 * tile[2];
       
-      for(unsigned ib = 0; ib < h.hr.NHoppings(io); ib++)
-        {
-          T tt  = value_type(MULT + 1) * h.hr.hopping(ib, io);
-          b3.set_coord(h.hr.dist(ib,io)); //  hr.dist has the coordinated in 3 Basis of relative hopping
-          vee.array() -= 1;
-          
-          if (VELOCITY)
-            tt  *=  h.hr.v.at(axis)(ib,io);
-          
-          for(std::size_t i2 = 0; i2 < TILE; i2++ )
-            {
-              value_type phase = vee(0) * (global.coord[2] + i2) * r.ghost_pot(0,D - 1);
-              mult_t1_ghost_cor[io][ib][i2] =  tt * multEiphase(phase);
-            }
-        }
-    }  
+      // Local Energy and Hoppings
+      mult_tile<MULT, VELOCITY, FIELD>(j0, io, i2 - NGHOSTS, init, it);
+    }
+  for(auto id = h.hd.begin(); id != h.hd.end(); id++)
+    id->template multiply_defect<MULT, VELOCITY>(istr, phi0, phiM1, axis, NBlock);
+  
+  // Empty the vacancies in the tile
+  auto & hV = h.hV.position.at(istr);
+  for(auto k = hV.begin(); k != hV.end(); k++)
+    std::fill_n(phi0 + *k * NBlock, NBlock, 0.);
+  
+  // Products with the finished tile, while it is still in cache
+  if(mu != nullptr)
+    for(std::size_t io = 0; io < r.Orb; io++)
+      {
+        const std::size_t j0 = io * x.basis[3] + i0 + i1 * tile[1] + i2 * tile[2];
+        for(std::size_t j2 = j0; j2 < j0 + r.tile * tile[2]; j2 += tile[2])
+          for(std::size_t j = j2; j < j2 + r.tile * tile[1]; j += tile[1])
+            this->dot_row((dot_bra == nullptr ? phiM1 : dot_bra) + j * NBlock, phiM1 + j * NBlock, phi0 + j * NBlock, r.tile, mu, err);
+      }
 }
 
-
-
 template <typename T>
-template <unsigned MULT, bool VELOCITY>
+template <unsigned MULT, bool VELOCITY, bool FIELD>
 void KPM_Vector <T, 3>::KPM_MOTOR(T * phi0a, T * phiM1a, T *phiM2a, unsigned axis)
 {
-  std::size_t i0, i1, i2;
-  Coordinates<std::size_t, D + 1> x(r.Ld);
   phi0 = phi0a;
   phiM1 = phiM1a;
   phiM2 = phiM2a;
@@ -707,41 +887,38 @@ void KPM_Vector <T, 3>::KPM_MOTOR(T * phi0a, T * phiM1a, T *phiM2a, unsigned axi
   for(auto istr = h.cross_mozaic_indexes.begin(); istr != h.cross_mozaic_indexes.end() ; istr++)
     initiate_stride<MULT>(*istr);
   
-  for( i2 = NGHOSTS; i2 < r.Ld[2] - NGHOSTS; i2 += TILE  )
+  hoppings = h.hr.regular_hoppings(MULT, VELOCITY, axis);
+  
+  // The tiles are shared by the team of the domain, unless the defects reach into the tiles of other threads
+  const unsigned team = (h.hd.empty() ? r.team : 1);
+  if(team == 1)
+    for(std::size_t istr = 0; istr < r.NStr; istr++)
+      motor_tile<MULT, VELOCITY, FIELD>(istr, axis, 0, dot_mu, dot_err.data());
+  else
     {
-      build_regular_phases<MULT,VELOCITY>(i2, axis);
-      for( i1 = NGHOSTS; i1 < r.Ld[1] - NGHOSTS; i1 += TILE  )
-        for( i0 = NGHOSTS; i0 < r.Ld[0] - NGHOSTS; i0 += TILE )
-          {
-            
-            std::size_t istr = ((i2 - NGHOSTS) / TILE * r.lStr[1] + (i1 - NGHOSTS) / TILE) * r.lStr[0] + (i0 - NGHOSTS) / TILE;
-            if(h.cross_mozaic.at(istr))
-              initiate_stride<MULT>(istr);
-            // These four lines pertrain only to the magnetic field
-            for(std::size_t io = 0; io < r.Orb; io++)
-              {
-                const std::size_t ip = io * x.basis[3];
-                const std::size_t j0 = ip + i0 + i1 * tile[1] + i2 * tile[2];
-		
-                // Local Energy
-                if(!VELOCITY) mult_local_disorder<MULT>(j0, io);
-		
-                // Hoppings
-                mult_regular_hoppings(j0, io);
-              }
-            for(auto id = h.hd.begin(); id != h.hd.end(); id++)
-              id->template multiply_defect<MULT, VELOCITY>(istr, phi0, phiM1, axis);
-            
-            // Empty the vacancies in the tile
-            auto & hV = h.hV.position.at(istr);
-            for(auto k = hV.begin(); k != hV.end(); k++)
-              phi0[*k] = 0.;
-
-          }
+      // Each thread sums its own products, which are added in the order of the threads
+      if(dot_mu != nullptr)
+        team_dots.setZero(2 * NBlock, 2 * team);
+#pragma omp parallel num_threads(team)
+      {
+        const unsigned it = omp_get_thread_num();
+        accumulator * mu = (dot_mu == nullptr ? nullptr : team_dots.col(2 * it).data());
+        accumulator * err = (dot_mu == nullptr ? nullptr : team_dots.col(2 * it + 1).data());
+#pragma omp for schedule(static)
+        for(std::size_t istr = 0; istr < r.NStr; istr++)
+          motor_tile<MULT, VELOCITY, FIELD>(istr, axis, it, mu, err);
+      }
+      if(dot_mu != nullptr)
+        for(unsigned it = 0; it < team; it++)
+          for(unsigned k = 0; k < 2 * NBlock; k++)
+            {
+              compensated_add(dot_mu[k], dot_err.data()[k], team_dots(k, 2 * it));
+              dot_err.data()[k] += team_dots(k, 2 * it + 1);
+            }
     }
 
   for(auto vc =  h.hV.vacancies_with_defects.begin(); vc != h.hV.vacancies_with_defects.end(); vc++)
-    phi0[*vc] = 0.;
+    std::fill_n(phi0 + *vc * NBlock, NBlock, 0.);
 
     
   /* 
@@ -752,11 +929,7 @@ void KPM_Vector <T, 3>::KPM_MOTOR(T * phi0a, T * phiM1a, T *phiM2a, unsigned axi
   */
 
   for(auto id = h.hd.begin(); id != h.hd.end(); id++)
-    id->template multiply_broken_defect<MULT,VELOCITY>(phi0, phiM1,axis);
-	  
-  // These four lines pertrain only to the magnetic field
-  Exchange_Boundaries();
-  
+    id->template multiply_broken_defect<MULT, VELOCITY, FIELD>(phi0, phiM1, axis, NBlock);
 }
 
 
@@ -803,9 +976,9 @@ void KPM_Vector <T, 3>::build_site(unsigned long pos){
 
 
 template <typename T>
-void KPM_Vector <T, 3>::build_planewave(Eigen::Matrix<double,-1,1> & k, Eigen::Matrix<T,-1,1> & weight){
+void KPM_Vector <T, 3>::build_planewave(Eigen::Matrix<double,-1,-1> & k, Eigen::Matrix<T,-1,1> & weight){
   
-    // Builds an initial vector which is a plane wave with a specific value of k
+    // Builds an initial block of plane waves, one for each column of k. The remaining vectors of the block are zero
     // weight is the weight of each orbital for this plane wave 
     // |k> = sum_{r,R} w(R) exp(i k.r + i k.R) |r,R>
     // r = lattice vector
@@ -818,37 +991,40 @@ void KPM_Vector <T, 3>::build_planewave(Eigen::Matrix<double,-1,1> & k, Eigen::M
 
 
     index = 0;    // sets the KPM index to 0
+    v.col(0).setZero();
+    const unsigned nk = k.cols();
     Coordinates<std::size_t, D + 1> local_coords(r.Ld), global_coords(r.Lt);
+    r.convertCoordinates(global_coords, local_coords.set({std::size_t(NGHOSTS), std::size_t(NGHOSTS), std::size_t(NGHOSTS), std::size_t(0)}));
 
-    Eigen::Map<Eigen::Matrix<std::size_t, 3, 1>> position(global_coords.coord); // spacial part of the coord vector in global_coords
     auto orb_a_coords = r.rLat.inverse() * r.rOrb;          // column i is the position of the i-th orbital in basis a
                                                             // r.rLat.inverse() each row is a bi / 2*M_PI 
-    Eigen::Array<T, -1, 1> exp_R;
-    exp_R = Eigen::Array<T, -1, 1>::Zero(r.Orb, 1);   // exponential related to the orbital
-    T exp_r;                                                // exponential related to the lattice site
+    Eigen::Array<T, -1, -1> exp_R(r.Orb, nk);               // exponential related to the orbital
+    Eigen::Array<T, -1, -1> exp_r[3];                       // exponential related to the lattice site, along each direction
 
     // Calculate the exponential related to the orbital exp(i k R) w(R)
     // It is already divided by the norm, which is the number of total sites r.Nt
-    for(std::size_t io = 0; io < r.Orb; io++)
-        exp_R(io) = weight(io)*exp(assign_value(0, 2.0*M_PI*orb_a_coords.col(io).transpose()*k))/T(sqrt(r.Nt));
+    for(unsigned ik = 0; ik < nk; ik++)
+      for(std::size_t io = 0; io < r.Orb; io++)
+        exp_R(io, ik) = weight(io)*multEiphase(2.0*M_PI*orb_a_coords.col(io).dot(k.col(ik)))/T(sqrt(r.Nt));
 
-    // Calculate the exponential related to each unit cell
-    for(std::size_t i2 = NGHOSTS; i2 < r.Ld[2] - NGHOSTS; i2++)
-      for(std::size_t i1 = NGHOSTS; i1 < r.Ld[1] - NGHOSTS; i1++)
-        for(std::size_t i0 = NGHOSTS; i0 < r.Ld[0] - NGHOSTS; i0++)
-          {
-            local_coords.set({i0,i1,i2, std::size_t(0)});
-            r.convertCoordinates(global_coords, local_coords);          // Converts the coordinates within a thread to global coordinates
-            
-            exp_r = exp(assign_value(0,  2.0*M_PI * position.cast<double>().transpose()*k ));
-            
-            for(std::size_t io = 0; io < r.Orb; io++)
-              {
-                local_coords.set({i0,i1,io});
-                v(local_coords.index, 0) = exp_r*exp_R(io);
-              }
-          }
-    
+    // exp(i k.r) factorizes along the lattice vectors, so it is tabulated once for each direction of the domain
+    for(unsigned d = 0; d < 3; d++)
+      {
+        exp_r[d].resize(r.ld[d], nk);
+        for(unsigned ik = 0; ik < nk; ik++)
+          for(std::size_t i = 0; i < r.ld[d]; i++)
+            exp_r[d](i, ik) = multEiphase(2.0*M_PI*double(global_coords.coord[d] + i)*k(d, ik));
+      }
+
+    for(std::size_t io = 0; io < r.Orb; io++)
+      for(std::size_t i2 = 0; i2 < r.ld[2]; i2++)
+        for(std::size_t i1 = 0; i1 < r.ld[1]; i1++)
+          for(std::size_t i0 = 0; i0 < r.ld[0]; i0++)
+            {
+              const std::size_t j = local_coords.set({i0 + NGHOSTS, i1 + NGHOSTS, i2 + NGHOSTS, io}).index * NBlock;
+              for(unsigned ik = 0; ik < nk; ik++)
+                v(j + ik, 0) = exp_r[0](i0, ik)*exp_r[1](i1, ik)*exp_r[2](i2, ik)*exp_R(io, ik);
+            }
 }
 
 
@@ -874,3 +1050,18 @@ template void KPM_Vector<long double ,3u>::Multiply<1u>();
 template void KPM_Vector<std::complex<float> ,3u>::Multiply<1u>();
 template void KPM_Vector<std::complex<double> ,3u>::Multiply<1u>();
 template void KPM_Vector<std::complex<long double> ,3u>::Multiply<1u>();
+
+template void KPM_Vector<float ,3u>::Multiply<0u>(const float *, Eigen::Matrix<double, -1, 2> &);
+template void KPM_Vector<double ,3u>::Multiply<0u>(const double *, Eigen::Matrix<double, -1, 2> &);
+template void KPM_Vector<long double ,3u>::Multiply<0u>(const long double *, Eigen::Matrix<long double, -1, 2> &);
+template void KPM_Vector<std::complex<float> ,3u>::Multiply<0u>(const std::complex<float> *, Eigen::Matrix<std::complex<double>, -1, 2> &);
+template void KPM_Vector<std::complex<double> ,3u>::Multiply<0u>(const std::complex<double> *, Eigen::Matrix<std::complex<double>, -1, 2> &);
+template void KPM_Vector<std::complex<long double> ,3u>::Multiply<0u>(const std::complex<long double> *, Eigen::Matrix<std::complex<long double>, -1, 2> &);
+
+template void KPM_Vector<float ,3u>::Multiply<1u>(const float *, Eigen::Matrix<double, -1, 2> &);
+template void KPM_Vector<double ,3u>::Multiply<1u>(const double *, Eigen::Matrix<double, -1, 2> &);
+template void KPM_Vector<long double ,3u>::Multiply<1u>(const long double *, Eigen::Matrix<long double, -1, 2> &);
+template void KPM_Vector<std::complex<float> ,3u>::Multiply<1u>(const std::complex<float> *, Eigen::Matrix<std::complex<double>, -1, 2> &);
+template void KPM_Vector<std::complex<double> ,3u>::Multiply<1u>(const std::complex<double> *, Eigen::Matrix<std::complex<double>, -1, 2> &);
+template void KPM_Vector<std::complex<long double> ,3u>::Multiply<1u>(const std::complex<long double> *, Eigen::Matrix<std::complex<long double>, -1, 2> &);
+
@@ -17,50 +17,74 @@ private:
   std::size_t           tile_ghosts[3];
   std::size_t           transf_max[3][3]; // [d][Maximum lateral bondary lengh]
   std::size_t      transf_bound[3][2][3]; // [d][edged][Lateral boundary lengh]
-  T                 ***mult_t1_ghost_cor;
+  const T                                              *hoppings;       // Hoppings with the Peierls phases of each plane (Periodic_Operator::regular_hoppings)
+  std::vector<std::ptrdiff_t>                            row_distances;  // Distances in memory of the hoppings
+  std::vector<typename extract_value_type<T>::value_type> row_onsite;     // Local energies of a tile row
   T                                *phi0;
   T                               *phiM1;
   T                               *phiM2;
+  bool                            s_step;   // Multiply can recompute the ghosts itself (see defer_exchange)
+  const T                        *dot_bra;   // Bra of the products taken by KPM_MOTOR, phiM1 when null (see Multiply(bra, mu))
+  typename accumulator_type<T>::type *dot_mu;   // Where KPM_MOTOR accumulates the products, none when null
+  Eigen::Matrix<typename accumulator_type<T>::type, -1, 2> dot_err;   // Rounding errors of the sums in dot_mu (see compensated_add)
+  Eigen::Matrix<typename accumulator_type<T>::type, -1, -1> team_dots; // Products of each thread of the team and their rounding errors, side by side
 public:
   LatticeStructure<3u>               & r;
   Hamiltonian<T,3u>                  & h;
   //  Coordinates<std::size_t,4>           x;
   typedef typename extract_value_type<T>::value_type value_type;
+  typedef typename accumulator_type<T>::type accumulator;
   using KPM_VectorBasis<T,3>::simul;
   using KPM_VectorBasis<T,3>::index;
   using KPM_VectorBasis<T,3>::v;
   using KPM_VectorBasis<T,3>::memory;
+  using KPM_VectorBasis<T,3>::NBlock;
   using KPM_VectorBasis<T,3>::aux_wr;
   using KPM_VectorBasis<T,3>::aux_test;
   using KPM_VectorBasis<T,3>::inc_index;
   using KPM_VectorBasis<T,3>::assign_value;
   using KPM_VectorBasis<T,3>::myconj;
   using KPM_VectorBasis<T,3>::multEiphase;
+  using KPM_VectorBasis<T,3>::deferred;
+  using KPM_VectorBasis<T,3>::ghost_depth;
+  using KPM_VectorBasis<T,3>::stale_ghosts;
+  using KPM_VectorBasis<T,3>::invalidate_ghosts;
+  using KPM_VectorBasis<T,3>::cone;
+  using KPM_VectorBasis<T,3>::cone_inside;
+  using KPM_VectorBasis<T,3>::cone_tiles;
+  using KPM_VectorBasis<T,3>::light_cone_step;
   
-  KPM_Vector(int mem, Simulation<T,3> & sim);
+  KPM_Vector(int mem, Simulation<T,3> & sim, unsigned nblock = 1);
   ~KPM_Vector(void);
   void initiate_vector();
+  void initiate_vector(unsigned nvec);
   T get_point();
   void build_wave_packet(Eigen::Matrix<double,-1,-1> & k, Eigen::Matrix<T,-1,-1> & psi0, double & sigma,
                          Eigen::Matrix<double,1,2> & vb);
-  template < unsigned MULT,bool VELOCITY> 
-  void build_regular_phases(int i1, unsigned axis);
   template < unsigned MULT> 
   void initiate_stride(std::size_t & istr);
-  template < unsigned MULT> 
-  void inline mult_local_disorder(const  std::size_t & j0, const  std::size_t & io);
-  void inline mult_regular_hoppings(const  std::size_t & j0, const  std::size_t & io);
+  template <unsigned MULT, bool VELOCITY, bool FIELD> 
+  void inline mult_tile(const  std::size_t & j0, const  std::size_t & io, std::size_t row, bool init, unsigned it);
   template <unsigned MULT> 
   void Multiply();
+  template <unsigned MULT>
+  void Multiply(const T * bra, Eigen::Matrix<typename accumulator_type<T>::type, -1, 2> & mu);
   void Velocity(T * phi0,T * phiM1, unsigned axis);
   void Velocity(T * phi0,T * phiM1, int);
-  template <unsigned MULT, bool VELOCITY>
+  template <unsigned MULT, bool VELOCITY, bool FIELD>
+  void motor_tile(std::size_t istr, unsigned axis, unsigned it, accumulator * mu, accumulator * err);
+  template <unsigned MULT, bool VELOCITY, bool FIELD>
   void KPM_MOTOR(T * phi0a, T * phiM1a, T *phiM2a, unsigned axis);
+  template <unsigned MULT>
+  void mult_ghosts(unsigned depth);
   void measure_wave_packet(T * bra, T * ket, T * results);  
   void Exchange_Boundaries();
+  void Exchange_Boundaries(unsigned ncols);
+  void refresh_ghosts();
+  void defer_exchange(bool defer);
   void test_boundaries_system();
   void empty_ghosts(int mem_index);
   void build_site(unsigned long R);
-  void build_planewave(Eigen::Matrix<double,-1,1> & k, Eigen::Matrix<T,-1,1> & weight);
+  void build_planewave(Eigen::Matrix<double,-1,-1> & k, Eigen::Matrix<T,-1,1> & weight);
 };
       
@@ -11,8 +11,8 @@
 #include "Coordinates.hpp"
 #include "LatticeStructure.hpp"
 #include "Generic.hpp"
-#include "Global.hpp"
 #include "ComplexTraits.hpp"
+#include "Global.hpp"
 #include "Random.hpp"
 template <typename T, unsigned D>
 class Hamiltonian;
@@ -26,19 +26,39 @@ class KPM_Vector;
 
 
 template<typename T, unsigned D>
-KPM_VectorBasis<T,D>::KPM_VectorBasis(int mem,  Simulation<T,D> & sim) : memory(mem), simul(sim) {
+KPM_VectorBasis<T,D>::KPM_VectorBasis(int mem,  Simulation<T,D> & sim, unsigned nblock) : memory(mem), NBlock(nblock), simul(sim), deferred(false), cone(false), cone_inside(false) {
   index  = 0;
-  v = Eigen::Matrix <T, Eigen::Dynamic,  Eigen::Dynamic >::Zero(simul.r.Sized, memory);
+  ghost_depth[0] = ghost_depth[1] = NGHOSTS;
+  stale_ghosts.assign(memory, false);
+  v = Eigen::Matrix <T, Eigen::Dynamic,  Eigen::Dynamic >::Zero(simul.r.Sized * NBlock, memory);
 }
 
 template<typename T, unsigned D>
 void KPM_VectorBasis<T,D>::set_index(int i) {
+  // The columns selected by hand are expected to have their ghosts exchanged, unless they were invalidated
   index = i;
+  ghost_depth[0] = (stale_ghosts[index] ? 0 : NGHOSTS);
+  ghost_depth[1] = (stale_ghosts[(memory + index - 1) % memory] ? 0 : NGHOSTS);
 }
 
 template<typename T, unsigned D>
 void KPM_VectorBasis<T,D>::inc_index() {
   index = (index + 1) % memory;
+  ghost_depth[1] = ghost_depth[0];
+  ghost_depth[0] = 0;
+  stale_ghosts[index] = false;
+}
+
+template<typename T, unsigned D>
+void KPM_VectorBasis<T,D>::invalidate_ghosts() {
+  /*
+    Tells that only the interior of the current column is up to date, as after Velocity or when
+    the column was filled by hand. The ghosts are then exchanged by the first stencil that reads
+    them (Multiply, or refresh_ghosts before a Velocity), and not at all by the columns only used
+    in products with emptied ghosts or taken over the interior.
+  */
+  ghost_depth[0] = 0;
+  stale_ghosts[index] = true;
 }
 
 template<typename T, unsigned D>
@@ -46,6 +66,73 @@ unsigned KPM_VectorBasis<T,D>::get_index() {
   return index;
 }
 
+template<typename T, unsigned D>
+void KPM_VectorBasis<T,D>::light_cone(std::size_t pos) {
+  /*
+    Tells that the current column vanishes outside of the unit cell of the global position pos,
+    as built by build_site. The hoppings only connect neighbouring unit cells, so after n
+    multiplications the vector vanishes outside of the box of cells within n of that one. Until
+    the box covers the sample, Multiply skips the tiles out of it, and the exchange of the ghosts
+    while the box stays away from the borders of all the domains.
+    Structural disorder can connect farther cells, so it is not used with it.
+  */
+  Coordinates<std::size_t, D + 1> z(simul.r.Lt);
+  z.set_coord(pos);
+  std::copy_n(z.coord, D, cone_origin);
+  cone_steps = 0;
+  cone_inside = false;
+  cone = simul.h.hd.empty();
+
+  // The tiles skipped by Multiply keep what was in the column before
+  if(cone)
+    for(int c = 0; c < memory; c++)
+      if(c != index)
+        v.col(c).setZero();
+}
+
+template<typename T, unsigned D>
+void KPM_VectorBasis<T,D>::light_cone_step() {
+  // Grows the box of the light cone by one cell for the multiplication about to be done
+  if(!cone)
+    return;
+  
+  LatticeStructure<D> & r = simul.r;
+  Coordinates<std::size_t, D + 1> xd(std::size_t(r.thread_id), r.nd);
+  bool covered = true;
+  cone_steps++;
+  cone_inside = true;
+  for(unsigned d = 0; d < D; d++)
+    {
+      const std::size_t L = r.Lt[d], width = 2 * cone_steps + 1;
+      const std::ptrdiff_t lo = std::ptrdiff_t(cone_origin[d]) - std::ptrdiff_t(cone_steps), hi = lo + std::ptrdiff_t(width) - 1;
+      const std::ptrdiff_t ld = r.ld[d];
+      cone_inside = cone_inside && lo >= 0 && hi < std::ptrdiff_t(L) && lo / ld == hi / ld &&
+        lo % ld >= NGHOSTS && hi % ld < ld - NGHOSTS;
+      covered = covered && width >= L;
+      
+      // A tile is reached when its first cell is in the box or the first cell of the box is in it
+      const std::size_t s = std::size_t((lo % std::ptrdiff_t(L) + std::ptrdiff_t(L)) % std::ptrdiff_t(L));
+      cone_tiles[d].assign(r.lStr[d], width >= L);
+      for(std::size_t t = 0; t < r.lStr[d]; t++)
+        {
+          const std::size_t a = xd.coord[d] * r.ld[d] + t * r.tile;
+          if((a + L - s) % L < width || (s + L - a) % L < r.tile)
+            cone_tiles[d][t] = true;
+        }
+    }
+  
+  // From now on all the tiles are swept
+  if(covered)
+    cone = cone_inside = false;
+}
+
+template<typename T, unsigned D>
+Eigen::Map<Eigen::Matrix<T, -1, -1>, 0, Eigen::Stride<-1, -1>> KPM_VectorBasis<T,D>::block_vector(unsigned ib, std::size_t i, std::size_t n, int c, int m) {
+  // View of the vector ib of the block restricted to the sites [i, i + n) and to the columns [c, c + m)
+  return Eigen::Map<Eigen::Matrix<T, -1, -1>, 0, Eigen::Stride<-1, -1>>(v.data() + c * v.rows() + i * NBlock + ib, n, m,
+                                                                          Eigen::Stride<-1, -1>(v.rows(), NBlock));
+}
+
 template<typename T, unsigned D>
 bool KPM_VectorBasis<T,D>::aux_test(T & x, T & y ) {
   return (abs(x - y) > std::numeric_limits<double>::epsilon());
@@ -5,21 +5,124 @@
 /*                                                         */
 /***********************************************************/
 
+#include "StencilKernels.hpp"
+
 template <typename T, unsigned D>
 class KPM_VectorBasis: public ComplexTraits<T> {
 protected:
   int index;
   const int memory;
+  const unsigned NBlock;          // Number of vectors stored interleaved site by site
   Simulation<T,D> & simul;  
+  bool deferred;                  // Multiply may leave ghost layers out of date (see defer_exchange)
+  unsigned ghost_depth[2];        // Up to date ghost layers of the current and of the previous column
+  std::vector<bool> stale_ghosts; // Columns whose ghosts were left out of date (see invalidate_ghosts)
+  bool cone;                      // Multiply only sweeps the tiles reached from a single site (see light_cone)
+  bool cone_inside;               // The last column vanishes on the borders of every domain
+  std::size_t cone_origin[D];     // Unit cell of the site, in the coordinates of the sample
+  std::size_t cone_steps;         // Multiplications done since the vector was a single site
+  std::vector<bool> cone_tiles[D]; // Tiles of the domain reached along each direction
+  void light_cone_step();
 public:
   using ComplexTraits<T>::assign_value;
   using ComplexTraits<T>::myconj;
   using ComplexTraits<T>::multEiphase;
   using ComplexTraits<T>::aux_wr;
   Eigen::Matrix <T, Eigen::Dynamic,  Eigen::Dynamic > v;  
-  KPM_VectorBasis(int mem,  Simulation<T,D> & sim);
+  KPM_VectorBasis(int mem,  Simulation<T,D> & sim, unsigned nblock = 1);
   void set_index(int i);
   void inc_index();  
+  void invalidate_ghosts();
   unsigned get_index();
+  void light_cone(std::size_t pos);
   bool aux_test(T & x, T & y );  
+  Eigen::Map<Eigen::Matrix<T, -1, -1>, 0, Eigen::Stride<-1, -1>> block_vector(unsigned ib, std::size_t i, std::size_t n, int c, int m);
+
+  typedef typename extract_value_type<T>::value_type value_type;
+  typedef typename accumulator_type<T>::type accumulator;
+  template <unsigned MULT>
+  void stencil_row(T * phi0, const T * phiM1, const T * phiM2, std::size_t n, bool init,
+                   const value_type * U, unsigned nhop, const T * t, const std::ptrdiff_t * d);
+  template <unsigned MULT>
+  void stencil_block(T * phi0, const T * phiM1, const T * phiM2, std::size_t n, bool init,
+                     const value_type * U, unsigned nhop, const T * t, const std::ptrdiff_t * d);
+  void dot_row(const T * bra, const T * phiM1, const T * phi0, std::size_t n, accumulator * mu, accumulator * err);
 };
+
+template <typename T, unsigned D>
+template <unsigned MULT>
+inline void KPM_VectorBasis<T,D>::stencil_row(T * phi0, const T * phiM1, const T * phiM2, std::size_t n, bool init,
+                                              const value_type * U, unsigned nhop, const T * t, const std::ptrdiff_t * d)
+{
+  /* 
+     Fused stencil over n consecutive elements of a tile row:
+     phi0 = - MULT phiM2 + (MULT + 1) U phiM1 + sum_ib t[ib] phiM1[. + d[ib]]
+     If init is false the tile has already been initialized (defects from a previous tile)
+     and the result is added to phi0 instead. U may be null when there is no local energy.
+     The row is processed in blocks of STENCIL_BLOCK elements so that phi0 is only
+     read and written once, while all the hoppings are accumulated in registers.
+     When there is a vectorized kernel for T (see StencilKernels.hpp) it processes the row
+     first and the generic code only deals with the elements it has left.
+  */
+  std::size_t k0 = 0;
+  if(StencilKernels<T>::row != nullptr)
+    k0 = StencilKernels<T>::row(phi0, phiM1, phiM2, n, init, MULT, U, nhop, t, d);
+  for(; k0 + STENCIL_BLOCK <= n; k0 += STENCIL_BLOCK)
+    stencil_block<MULT>(phi0 + k0, phiM1 + k0, phiM2 + k0, STENCIL_BLOCK, init, (U == nullptr ? U : U + k0), nhop, t, d);
+  if(k0 < n)
+    stencil_block<MULT>(phi0 + k0, phiM1 + k0, phiM2 + k0, n - k0, init, (U == nullptr ? U : U + k0), nhop, t, d);
+}
+
+template <typename T, unsigned D>
+template <unsigned MULT>
+inline void KPM_VectorBasis<T,D>::stencil_block(T * phi0, const T * phiM1, const T * phiM2, std::size_t n, bool init,
+                                                const value_type * U, unsigned nhop, const T * t, const std::ptrdiff_t * d)
+{
+  T acc[STENCIL_BLOCK];
+  if(init)
+    for(std::size_t k = 0; k < n; k++)
+      acc[k] = - value_type(MULT) * phiM2[k];
+  else
+    for(std::size_t k = 0; k < n; k++)
+      acc[k] = phi0[k];
+
+  if(U != nullptr)
+    for(std::size_t k = 0; k < n; k++)
+      acc[k] += value_type(MULT + 1) * phiM1[k] * U[k];
+
+  for(unsigned ib = 0; ib < nhop; ib++)
+    {
+      const T t1 = t[ib];
+      const T * p = phiM1 + d[ib];
+      for(std::size_t k = 0; k < n; k++)
+        acc[k] += t1 * p[k];
+    }
+
+  for(std::size_t k = 0; k < n; k++)
+    phi0[k] = acc[k];
+}
+
+template <typename T, unsigned D>
+inline void KPM_VectorBasis<T,D>::dot_row(const T * bra, const T * phiM1, const T * phi0, std::size_t n, accumulator * mu, accumulator * err)
+{
+  /*
+    Adds the products over n consecutive sites of a row, for each vector ib of the block:
+    mu[ib] += <bra|phiM1> and mu[NBlock + ib] += <bra|phi0>
+    mu is the data of a NBlock x 2 column major matrix. The products are formed and summed
+    in the precision of the accumulator, and the row is summed on its own before being added to mu
+    with compensated_add, whose rounding errors are kept in err, laid out as mu
+  */
+  for(unsigned ib = 0; ib < NBlock; ib++)
+    {
+      accumulator sum1 = 0, sum0 = 0;
+      for(std::size_t k = ib; k < n * NBlock; k += NBlock)
+        {
+          T b = bra[k];
+          const accumulator c = accumulator(myconj(b));
+          sum1 += c * accumulator(phiM1[k]);
+          sum0 += c * accumulator(phi0[k]);
+        }
+      compensated_add(mu[ib],          err[ib],          sum1);
+      compensated_add(mu[NBlock + ib], err[NBlock + ib], sum0);
+    }
+}
@@ -15,7 +15,7 @@
 #include "LatticeStructure.hpp"
 
 template <unsigned D>
-LatticeStructure<D>::LatticeStructure(char *name )
+LatticeStructure<D>::LatticeStructure(char *name, unsigned tile0)
 {
   
 #pragma omp critical
@@ -36,6 +36,45 @@ LatticeStructure<D>::LatticeStructure(char *name )
       get_hdf5<int>(&MagneticField, file, (char *) "/Hamiltonian/MagneticFieldMul");
     }
     catch (H5::Exception& e){}
+
+    try {
+      H5::Exception::dontPrint();
+      get_hdf5<unsigned>(&NRandomBlock, file, (char *) "/NumRandomsBlock");
+    }
+    catch (H5::Exception& e){}
+
+    // Tile size: TILE by default, 0 selects the fastest one at run time
+    try {
+      H5::Exception::dontPrint();
+      get_hdf5<unsigned>(&tile, file, (char *) "/Tile");
+    }
+    catch (H5::Exception& e){}
+
+    // Threads of each domain: 1 by default, 0 shares the processors left over by the domains
+    try {
+      H5::Exception::dontPrint();
+      get_hdf5<unsigned>(&team, file, (char *) "/Team");
+    }
+    catch (H5::Exception& e){}
+
+    // Vectors kept in memory by Gamma2D and Gamma3D: MEMORY by default, 0 chooses them from MemoryBudget
+    try {
+      H5::Exception::dontPrint();
+      get_hdf5<unsigned>(&NMemory, file, (char *) "/Memory");
+    }
+    catch (H5::Exception& e){}
+
+    try {
+      H5::Exception::dontPrint();
+      get_hdf5<double>(&MemoryBudget, file, (char *) "/MemoryBudget");
+    }
+    catch (H5::Exception& e){}
+
+    try {
+      H5::Exception::dontPrint();
+      get_hdf5<unsigned>(&bank, file, (char *) "/VectorBank");
+    }
+    catch (H5::Exception& e){}
     file->close();
   }
 
@@ -43,7 +82,27 @@ LatticeStructure<D>::LatticeStructure(char *name )
   ghost_pot.setZero();
   ghost_pot(0,1) = MagneticField * 1.0 /Lt[1]*2.0*M_PI;
 
-  test_divisibility();
+  // A tile size chosen by the caller overrides the configuration file
+  if(tile0 != 0)
+    tile = tile0;
+  
+  if(tile != 0)
+    test_divisibility();
+
+  if(NRandomBlock == 0){
+    std::cout << "The number of random vectors in each block (NumRandomsBlock) must be positive. Exiting.\n";
+    exit(1);
+  }
+
+  if(bank > 2){
+    std::cout << "VectorBank must be 0 (no bank), 1 (in memory) or 2 (in a scratch file). Exiting.\n";
+    exit(1);
+  }
+
+  if(NMemory == 1){
+    std::cout << "The number of KPM vectors kept in memory (Memory) must be at least 2, or 0 to choose it at run time. Exiting.\n";
+    exit(1);
+  }
     
   Nd = 1;
   N = 1;
@@ -55,7 +114,7 @@ LatticeStructure<D>::LatticeStructure(char *name )
     {
       ld[i] = Lt[i]/nd[i];
       Ld[i] = ld[i] + 2*NGHOSTS;
-      lStr[i] = ld[i] / TILE;
+      lStr[i] = (tile != 0 ? ld[i] / tile : 0);
       Nd *= Ld[i];
       N  *= ld[i];
       Nt *= Lt[i] ;
@@ -63,6 +122,9 @@ LatticeStructure<D>::LatticeStructure(char *name )
       n_threads *= nd[i];
     }
 
+  if(team == 0)
+    team = std::max(1u, unsigned(omp_get_num_procs()) / n_threads);
+
   std::fill_n(lB3, D, 3); 
   lB3[D]  = Orb;  
   Lt[D] = Orb;
@@ -90,36 +152,38 @@ LatticeStructure<D>::LatticeStructure(char *name )
 }
 
 template <unsigned D>
-unsigned LatticeStructure<D>::get_BorderSize() {
-  unsigned size;
+std::size_t LatticeStructure<D>::get_BorderSize() {
+  // Computed in std::size_t, as large 3D domains with blocks of vectors go over 32 bits
+  std::size_t size;
   switch (D) {
   case 1 :
-    size = 2 * Orb * n_threads * NGHOSTS;
+    size = 2 * std::size_t(Orb) * n_threads * NGHOSTS;
     break;
   case 2:
-    size = 2 * std::max(Ld[0],ld[1]) * Orb * n_threads * NGHOSTS;
+    size = 2 * std::size_t(std::max(Ld[0],ld[1])) * Orb * n_threads * NGHOSTS;
     break;
   case 3:
-    size = 2 * std::max(Ld[0] * Ld[1], std::max(Ld[0] * ld[2] , ld[1]*ld[2]) ) * Orb * n_threads * NGHOSTS;
+    size = 2 * std::max(std::size_t(Ld[0]) * Ld[1], std::max(std::size_t(Ld[0]) * ld[2] , std::size_t(ld[1]) * ld[2]) ) * Orb * n_threads * NGHOSTS;
     break;
   default:
     std::cout << "Error in LatticeBuilding.hpp. Exiting.\n";
     exit(1);
   }
-  return size;
+  // Room for two columns, exchanged together by the deferred Multiply, in every direction
+  return 2 * D * size * NRandomBlock;
 }
 
 
 template <unsigned D>
 void LatticeStructure<D>::test_divisibility() {
   debug_message("Entered LatticeStructure::test_divisibility.\n");
-  // Test if TILE x nd divides the length
+  // Test if tile x nd divides the length
 
   for(unsigned i = 0; i < D; i++){
-    if(Lt[i]%(nd[i] * TILE) != 0){
+    if(Lt[i]%(nd[i] * tile) != 0){
       std::cout << "The system size in direction " << i << " (" << Lt[i] <<  ") ";
       std::cout << "must be a multiple of the number of divisions in that ";
-      std::cout << "direction (" << nd[i] << ") times TILE (" << TILE << "). ";
+      std::cout << "direction (" << nd[i] << ") times the tile size (" << tile << "). ";
       std::cout << "Exiting.\n";
       exit(1);
     }
@@ -185,7 +249,7 @@ void  LatticeStructure<D>::convertCoordinates(Coordinates<T1, D + 1> & dest, Coo
   if( std::equal(std::begin(source.L), std::end(source.L), std::begin(Ld)) && std::equal(std::begin(dest.L), std::end(dest.L), std::begin(lStr)))
     {
       for(unsigned i = 0; i < D; i++)
-        dest.coord[i] = (source.coord[i] -NGHOSTS) / TILE;
+        dest.coord[i] = (source.coord[i] -NGHOSTS) / tile;
       dest.coord[D] = 0;
       dest.set_index(dest.coord);
     }
@@ -195,7 +259,7 @@ void  LatticeStructure<D>::convertCoordinates(Coordinates<T1, D + 1> & dest, Coo
   if( std::equal(std::begin(source.L), std::end(source.L), std::begin(ld)) && std::equal(std::begin(dest.L), std::end(dest.L), std::begin(lStr)))
     {
       for(unsigned i = 0; i < D; i++)
-        dest.coord[i] = source.coord[i] / TILE; 
+        dest.coord[i] = source.coord[i] / tile; 
       dest.coord[D] = 0;
       dest.set_index(dest.coord);
     }
@@ -18,7 +18,8 @@ public:
   Eigen::Matrix<double, D, D> rLat;  // The vectors are organized by columns 
   Eigen::MatrixXd rOrb;              // The vectors of each orbital are organized by columns
   unsigned nd[D + 1]; // Number of domains in each dimension (the last dimension corresponding with Orbitals are not decomposed)
-  unsigned n_threads; // Number of threads
+  unsigned n_threads; // Number of threads, one for each domain
+  unsigned team = 1; // Threads that share the tiles of each domain (0 when it is chosen from the number of processors)
   
   unsigned Lt[D+1]; // Dimensions of the global sample
   unsigned Ld[D+1]; // Dimensions of each sub-domain (domain  + ghosts) 
@@ -34,11 +35,16 @@ public:
   unsigned Orb; // Number of orbitals
   unsigned thread_id; // thread identification
   int MagneticField = 0;
+  unsigned NRandomBlock = 1; // Number of random vectors propagated together through the KPM iteration
+  unsigned tile = TILE; // Linear size of the tiles of each subdomain (0 when it is to be tuned at run time)
+  unsigned NMemory = MEMORY; // Number of KPM vectors kept in memory by Gamma2D and Gamma3D (0 when it is chosen at run time)
+  double MemoryBudget = 0; // Memory in MB those vectors may take in all the threads together (0 for half of the physical memory)
+  unsigned bank = 0; // Gamma2D computes the right vectors once and keeps them in a VectorBank: 0 no, 1 in memory, 2 in a scratch file
   bool boundary[D][2]; // Information about the Global border in the subdomain 
   Eigen::Matrix<double, D, D> ghost_pot; // ghosts_correlation potential
   
-  LatticeStructure(char *);
-  unsigned get_BorderSize();
+  LatticeStructure(char *, unsigned tile0 = 0);
+  std::size_t get_BorderSize();
   template <typename T>
   void     convertCoordinates(Coordinates<T, D + 1> & dest, Coordinates<T, D + 1> & source);
   unsigned domain_number (long index);
@@ -11,62 +11,106 @@
 #include "Random.hpp"
 
 template <typename T>
-KPMRandom<T>::KPMRandom() {
+KPMRandom<T>::KPMRandom(std::uint32_t object) : sequence(0), realization(0), vectors(0) {
+  // object tells apart the generators of a Simulation, so that their sequences are the same
+  // whatever other Simulations were built before on the thread (see GlobalSimulation::tune_tile)
   init_random();
+  instance = (std::uint32_t(omp_get_thread_num()) << 16) + object;
 }
 
 template <typename T>
 void KPMRandom<T>::init_random()
 {
-
+  // The key has to be the same in all the threads, the counters make the draws of the domains different
+  std::uint64_t seed;
   char *env;
   env = getenv("SEED");
     if(env==NULL){
       // Didn't find the seed
-      std::random_device r;
-      std::array<int, 624> seed_data;
-      std::generate(seed_data.begin(), seed_data.end(), std::ref(r));
-      std::seed_seq seq(std::begin(seed_data), std::end(seed_data));
-      rng.seed(seq); 
+      static const std::uint64_t random_seed = [](){
+        std::random_device r;
+        return (std::uint64_t(r()) << 32) | r();
+      }();
+      seed = random_seed;
     }
     else {
       // Found the seed
-      rng.seed(atoi(env)); 
+      seed = std::strtoull(env, NULL, 10); 
     }
+  key[0] = std::uint32_t(seed);
+  key[1] = std::uint32_t(seed >> 32);
 }
 
 template <typename T>
-double  KPMRandom<T>::get() {
-  return dist(rng);
+void KPMRandom<T>::draw(std::uint64_t site, std::uint32_t sample, std::uint32_t stream, double & u0, double & u1) const
+{
+  // Two uniform numbers in [0, 1) with 53 random bits each
+  std::uint32_t c[4] = {std::uint32_t(site), std::uint32_t(site >> 32), sample, stream};
+  philox4x32(c, key[0], key[1]);
+  const double scale = 1. / 9007199254740992.;                 // 2^-53
+  u0 = double(((std::uint64_t(c[0]) << 32) | c[1]) >> 11) * scale;
+  u1 = double(((std::uint64_t(c[2]) << 32) | c[3]) >> 11) * scale;
 }
+
 template <typename T>
-double KPMRandom<T>::uniform(double  mean, double  width) {
+double  KPMRandom<T>::get(std::uint64_t site, std::uint32_t sample, std::uint32_t stream) const {
+  double u0, u1;
+  draw(site, sample, stream, u0, u1);
+  return u0;
+}
+
+template <typename T>
+double KPMRandom<T>::uniform(double  mean, double  width, std::uint64_t site, std::uint32_t sample, std::uint32_t stream) const {
     // mean  : mean value
     // width : root mean square deviation
-  return mean + sqrt(3.) * width * (2 * dist(rng)  - 1);
+  return mean + sqrt(3.) * width * (2 * get(site, sample, stream)  - 1);
 }
+
 template <typename T>
-double KPMRandom<T>::gaussian(double  mean, double  width) {
+double KPMRandom<T>::gaussian(double  mean, double  width, std::uint64_t site, std::uint32_t sample, std::uint32_t stream) const {
   // mean  : mean value
   // width : root mean square deviation
-  return mean + width*gauss(rng);
+  // Box-Muller transform, 1 - u0 is in (0, 1]
+  double u0, u1;
+  draw(site, sample, stream, u0, u1);
+  return mean + width * sqrt(-2. * log(1. - u0)) * cos(2 * M_PI * u1);
+}
+
+template <typename T>
+double  KPMRandom<T>::get() {
+  return get(sequence++, instance, SEQUENTIAL);
+}
+template <typename T>
+double KPMRandom<T>::uniform(double  mean, double  width) {
+  return uniform(mean, width, sequence++, instance, SEQUENTIAL);
+}
+template <typename T>
+double KPMRandom<T>::gaussian(double  mean, double  width) {
+  return gaussian(mean, width, sequence++, instance, SEQUENTIAL);
 }
 
 template <typename T>
 template <typename U>
-typename std::enable_if<is_tt<std::complex, U>::value, U>::type KPMRandom<T>::initA() {
-  return exp(T(0., value_type(2*M_PI*dist(rng)) ));
+typename std::enable_if<is_tt<std::complex, U>::value, U>::type KPMRandom<T>::initA(double u) const {
+  return exp(T(0., value_type(2*M_PI*u) ));
 }
 
 template <typename T>
 template <typename U>
-typename std::enable_if<!is_tt<std::complex, U>::value, U>::type KPMRandom<T>::initA() {
-  return (2*dist(rng) - 1.)*sqrt(3);
+typename std::enable_if<!is_tt<std::complex, U>::value, U>::type KPMRandom<T>::initA(double u) const {
+  return (2*u - 1.)*sqrt(3);
+}
+
+template <typename T>
+T KPMRandom<T>::init(std::uint64_t site, std::uint32_t sample) const {
+  return initA<T>(get(site, sample, RANDOM_VECTOR));
 }
 
 template <typename T>
-T KPMRandom<T>::init(){
-  return initA<T>();
+void KPMRandom<T>::init_row(T * out, std::size_t stride, std::uint64_t site, std::size_t n, std::uint32_t sample, value_type norm) const {
+  // The sites are independent of each other, there is no state carried along the row
+  for(std::size_t k = 0; k < n; k++)
+    out[k * stride] = init(site + k, sample) / norm;
 }
   
 template class KPMRandom<float>;
@@ -5,28 +5,68 @@
 /*                                                         */
 /***********************************************************/
 
+/*
+  Random numbers are generated with the counter-based Philox4x32-10 generator
+  (J. K. Salmon et al., "Parallel random numbers: as easy as 1, 2, 3", SC'11).
+  Every draw is a function of the key (the seed) and of a counter
+  (site, sample, stream) only, so that the random vectors and the Anderson
+  disorder do not depend on the domain decomposition, on the number of threads
+  or on the order in which the sites are visited:
+     site   : global index of the site in the Lt basis
+     sample : number of the random vector or of the disorder realization
+     stream : what the number is used for (see the enum below)
+  The sequential draws (get, uniform and gaussian without a counter) are used for the
+  positions of the vacancies and defects, which are chosen domain by domain; each
+  thread and each generator of a Simulation (object) have their own sequence.
+*/
+
+inline void philox4x32(std::uint32_t (&c)[4], std::uint32_t k0, std::uint32_t k1)
+{
+  const std::uint64_t M0 = 0xD2511F53, M1 = 0xCD9E8D57;
+  for(unsigned round = 0; round < 10; round++)
+    {
+      const std::uint64_t p0 = M0 * c[0], p1 = M1 * c[2];
+      const std::uint32_t c1 = c[1], c3 = c[3];
+      c[0] = std::uint32_t(p1 >> 32) ^ c1 ^ k0;
+      c[1] = std::uint32_t(p1);
+      c[2] = std::uint32_t(p0 >> 32) ^ c3 ^ k1;
+      c[3] = std::uint32_t(p0);
+      k0 += 0x9E3779B9;
+      k1 += 0xBB67AE85;
+    }
+}
+
 template <typename T> 
 class KPMRandom {
-  std::mt19937 rng;
-  std::uniform_real_distribution <double> dist;
-  std::normal_distribution<> gauss;
+  std::uint32_t key[2];
+  std::uint32_t instance;                   // Thread and object of the sequential draws
+  std::uint64_t sequence;                   // Number of sequential draws
+  void draw(std::uint64_t site, std::uint32_t sample, std::uint32_t stream, double & u0, double & u1) const;
 public:
   
   typedef typename extract_value_type<T>::value_type value_type;
+  enum : std::uint32_t {SEQUENTIAL = 0, RANDOM_VECTOR = 1, ANDERSON = 2};   // ANDERSON + model for each Anderson model
+  std::uint32_t realization;                // Disorder realizations generated so far
+  std::uint32_t vectors;                    // Random vectors generated so far
   
-  KPMRandom();
+  KPMRandom(std::uint32_t object);
   void init_random();
   double get();  
   double uniform(double  mean, double  width);
   double gaussian(double  mean, double  width);
   
+  double get(std::uint64_t site, std::uint32_t sample, std::uint32_t stream) const;
+  double uniform(double  mean, double  width, std::uint64_t site, std::uint32_t sample, std::uint32_t stream) const;
+  double gaussian(double  mean, double  width, std::uint64_t site, std::uint32_t sample, std::uint32_t stream) const;
+  
   template <typename U = T>
-  typename std::enable_if<is_tt<std::complex, U>::value, U>::type initA();
+  typename std::enable_if<is_tt<std::complex, U>::value, U>::type initA(double u) const;
   
   template <typename U = T>
-  typename std::enable_if<!is_tt<std::complex, U>::value, U>::type initA();
+  typename std::enable_if<!is_tt<std::complex, U>::value, U>::type initA(double u) const;
   
-  T init();
+  T init(std::uint64_t site, std::uint32_t sample) const;
+  // Entries of the random vector sample for the n consecutive global sites starting at site, divided by norm
+  void init_row(T * out, std::size_t stride, std::uint64_t site, std::size_t n, std::uint32_t sample, value_type norm) const;
   
 };
-
@@ -8,6 +8,7 @@
 
 
 #include "Generic.hpp"
+#include <unistd.h>
 #include "ComplexTraits.hpp"
 #include "Global.hpp"
 #include "Random.hpp"
@@ -24,10 +25,10 @@ class KPM_Vector;
 #include "KPM_Vector.hpp"
 
 template<typename T,unsigned D>
-Simulation<T,D>::Simulation(char *filename, GLOBAL_VARIABLES <T> & Global1): r(filename),  Global(Global1), name(filename), h(name, r, Global1)  {
+Simulation<T,D>::Simulation(char *filename, GLOBAL_VARIABLES <T> & Global1, unsigned tile): rnd(0), r(filename, tile),  Global(Global1), name(filename), h(name, r, Global1)  {
   // Initializes the Hamiltonian h, an instance of Lattice Structure r, 
   // and an instance of GLOBAL_VARIABLES Global1
-  ghosts.resize(Global.ghosts.size()/r.n_threads);
+  // A nonzero tile overrides the tile size of the configuration file
 }
 
 
@@ -35,6 +36,8 @@ template <typename T,unsigned D>
 void Simulation<T,D>::generalized_velocity(KPM_Vector<T,D>* kpm0, KPM_Vector<T,D>* kpm1, std::vector<std::vector<unsigned>> indices, int pos){
   // Check which generalized velocity operator needs to be calculated. 
   // reads from kpm1 and writes on kpm0
+  // The ghosts of kpm0 are left out of date, and exchanged only if a stencil reads them later
+  kpm1->refresh_ghosts();
   
   T * kpm1data = kpm1->v.col(kpm1->get_index()).data();
   T * kpm0data = kpm0->v.col(kpm0->get_index()).data();
@@ -59,6 +62,32 @@ void Simulation<T,D>::cheb_iteration(KPM_Vector<T,D>* kpm, long int current_iter
   }
 }
 
+template <typename T,unsigned D>
+int Simulation<T,D>::memory_block(int NMoments, int NBlock){
+  /*
+    Number of KPM vectors in each of the two blocks of vectors of Gamma2D and Gamma3D (blocks of
+    NBlock random vectors each). The Chebyshev iterations of the right vectors are repeated once
+    for every block of left vectors, so the blocks are made as large as the memory allows:
+    r.NMemory if it is set, otherwise as many vectors as fit in r.MemoryBudget, shared by the
+    threads. There is no use in more vectors than moments, and the recursion needs two of them.
+    The result only depends on the lattice, so that it is the same in every thread.
+  */
+  long memory = r.NMemory;
+  if(memory == 0){
+    double budget = r.MemoryBudget * 1024 * 1024;
+    if(budget <= 0)
+      budget = 0.5 * double(sysconf(_SC_PHYS_PAGES)) * double(sysconf(_SC_PAGE_SIZE));
+    const double column = double(sizeof(T)) * double(r.Sized) * double(NBlock);
+    memory = long(budget / r.n_threads / (2 * column));
+  }
+  memory = std::max(2l, std::min(memory, long(NMoments)));
+
+  if(r.NMemory == 0){
+    verbose_message("Vectors kept in memory: "); verbose_message(int(memory)); verbose_message("\n");
+  }
+  return int(memory);
+}
+
 
 
 template <typename T,unsigned D>	
@@ -14,15 +14,16 @@ public:
   using ComplexTraits<T>::assign_value;
   using ComplexTraits<T>::myconj;
   typedef typename extract_value_type<T>::value_type value_type;
+  typedef typename accumulator_type<T>::type accumulator;   // Type of the dot products (see accumulator_type)
   KPMRandom <T>          rnd;
-  std::vector<T>         ghosts;
   LatticeStructure <D>   r;      
   GLOBAL_VARIABLES <T> & Global;
   char                 * name;
   Hamiltonian<T,D>       h;
   
-  Simulation(char *, GLOBAL_VARIABLES <T> &);
+  Simulation(char *, GLOBAL_VARIABLES <T> &, unsigned tile = 0);
   void cheb_iteration(KPM_Vector<T,D>*, long int);
+  int  memory_block(int, int);
   void generalized_velocity(KPM_Vector<T,D> *, KPM_Vector<T,D> *, std::vector<std::vector<unsigned>>, int);
   //void Measure_Gamma(measurement_queue);
 
@@ -31,7 +32,7 @@ public:
   void Gamma3D(int, int, std::vector<int>,  std::vector<std::vector<unsigned>>, std::string );
   void GammaGeneral(int, int, std::vector<int>, std::vector<std::vector<unsigned>>, std::string );
   void recursive_KPM(int, int, std::vector<int>, long *, long *,  std::vector<std::vector<unsigned>>, std::vector<KPM_Vector<T,D>*> *, Eigen::Array<T, -1, -1> *);
-  void store_gamma(Eigen::Array<T, -1, -1> *, std::vector<int>,  std::vector<std::vector<unsigned>>, std::string );
+  void store_gamma(std::vector<int>,  std::vector<std::vector<unsigned>>, std::string, int );
   void store_gamma1D(Eigen::Array<T, -1, -1> *, std::string );
   void store_gamma3D(Eigen::Array<T, -1, -1> *, std::vector<int>, std::vector<std::vector<unsigned>>, std::string );
   std::vector<std::vector<unsigned>> process_string(std::string);
@@ -43,6 +44,7 @@ public:
   Eigen::Array<int, -1, 1> preserve_disorders,
   Eigen::Array<int, -1, 1> moments,
   int NDisorder, int NRandom, std::string direction_string);
+  void cheb_weighted_sum(KPM_Vector<T,D>*, Eigen::Matrix<T, -1, -1> &, KPM_Vector<T,D>*);
 
   
   void calc_conddc();
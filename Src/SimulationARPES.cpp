@@ -33,16 +33,7 @@ void Simulation<T,D>::store_ARPES(Eigen::Array<T, -1, -1> *gamma){
     // This barrier is essential
 #pragma omp barrier
 
-    long int nMoments   = gamma->rows();
-    long int nPositions = gamma->cols();
-
-
-#pragma omp master
-	Global.general_gamma = Eigen::Array<T, -1, -1 > :: Zero(nMoments, nPositions);
-#pragma omp barrier
-#pragma omp critical
-	Global.general_gamma += *gamma;
-#pragma omp barrier
+	Global.reduce(Global.general_gamma, *gamma);
     
     
 #pragma omp master
@@ -60,17 +51,21 @@ void Simulation<T,D>::store_ARPES(Eigen::Array<T, -1, -1> *gamma){
 
 template <typename T,unsigned D>
 void Simulation<T,D>::ARPES(int NDisorder, int NMoments, Eigen::Array<double, -1, -1> & k_vectors, Eigen::Matrix<T, -1, 1> & weight){
-    typedef typename extract_value_type<T>::value_type value_type;
+    // The moments are accumulated in double precision when the vectors are stored in single precision
+    typedef typename extract_value_type<accumulator>::value_type accumulator_value;
 
-    Eigen::Matrix<T, 1, 2> tmp;
+    Eigen::Matrix<accumulator, -1, 2> tmp;
     int Nk_vectors = k_vectors.rows();
-    Eigen::Matrix<double, -1, 1> k;
+    Eigen::Matrix<double, -1, -1> k;
+
+    // The k vectors are iterated in blocks of NBlock plane waves, interleaved site by site
+    const int NBlock = std::min(int(r.NRandomBlock), Nk_vectors);
 
-    KPM_Vector<T,D> kpm0(1, *this); // initial random vector
-    KPM_Vector<T,D> kpm1(2, *this); // left vector that will be Chebyshev-iterated on
+    KPM_Vector<T,D> kpm0(1, *this, NBlock); // initial plane waves
+    KPM_Vector<T,D> kpm1(2, *this, NBlock); // left vector that will be Chebyshev-iterated on
 
     // initialize the local gamma matrix and set it to 0
-    Eigen::Array<T, -1, -1> gamma = Eigen::Array<T, -1, -1 >::Zero(NMoments, Nk_vectors);
+    Eigen::Array<accumulator, -1, -1> gamma = Eigen::Array<accumulator, -1, -1 >::Zero(NMoments, Nk_vectors);
 
     // average for each k value
     Eigen::Array<long, -1, 1> average;
@@ -80,35 +75,38 @@ void Simulation<T,D>::ARPES(int NDisorder, int NMoments, Eigen::Array<double, -1
     for(int disorder = 0; disorder < NDisorder; disorder++){
         h.generate_disorder();
 
-        for(int k_index = 0; k_index < Nk_vectors; k_index++){
+        for(int k_index = 0; k_index < Nk_vectors; k_index += NBlock){
+            const int NVec = std::min(NBlock, Nk_vectors - k_index);
 
-            // Iterate over the list of k vectors
-            k = k_vectors.row(k_index);
+            // Iterate over the list of k vectors, one column of k for each vector of the block
+            k = k_vectors.block(k_index, 0, NVec, k_vectors.cols()).transpose().matrix();
 
-            kpm0.v.setZero();
             kpm0.build_planewave(k, weight); // already sets index=0
-            kpm0.Exchange_Boundaries();
 
             kpm1.set_index(0);
             kpm1.v.col(0) = kpm0.v.col(0);
-            kpm0.empty_ghosts(0);
+            kpm1.invalidate_ghosts();          // Exchanged by the first multiplication that needs them
 
+            // The last multiplication of each pair also takes the products <0|T_n> and <0|T_n+1>
+            // over the interior of the domain, so the ghosts of kpm0 are not emptied
             for(int n = 0; n < NMoments; n+=2){
-                for(int i = n; i < n+2; i++)
-                    if(i!=0) cheb_iteration(&kpm1, i-1);
-
-              
-                tmp.setZero();
-                for(std::size_t ii = 0; ii < r.Sized ; ii += r.Ld[0])
-                    tmp += kpm0.v.block(ii,0, r.Ld[0], 1).adjoint() * kpm1.v.block(ii, 0, r.Ld[0], 2);
-
-                gamma(n, k_index) += (tmp(0,0) - gamma(n, k_index))/value_type(average(k_index) + 1);			
-                gamma(n+1, k_index) += (tmp(0,1) - gamma(n+1, k_index))/value_type(average(k_index) + 1);			
+                if(n == 0)
+                    kpm1.template Multiply<0>(kpm0.v.data(), tmp);
+                else {
+                    kpm1.template Multiply<1>();
+                    kpm1.template Multiply<1>(kpm0.v.data(), tmp);
+                }
+
+                for(int ib = 0; ib < NVec; ib++){
+                    gamma(n, k_index + ib) += (tmp(ib,0) - gamma(n, k_index + ib))/accumulator_value(average(k_index + ib) + 1);			
+                    gamma(n+1, k_index + ib) += (tmp(ib,1) - gamma(n+1, k_index + ib))/accumulator_value(average(k_index + ib) + 1);			
+                }
             }
-            average(k_index)++;
+            average.segment(k_index, NVec) += 1;
         } 
     }
-    store_ARPES(&gamma);
+    Eigen::Array<T, -1, -1> gamma_T = gamma.template cast<T>();
+    store_ARPES(&gamma_T);
 }
 
 template <typename T, unsigned DIM>
@@ -28,15 +28,7 @@ template <typename T,unsigned D>
 void Simulation<T,D>::store_MU(Eigen::Array<T, -1, -1> *gamma){
     debug_message("Entered store_mu\n");
 
-    long int nMoments   = gamma->rows();
-    long int nPositions = gamma->cols();
-
-#pragma omp master
-	Global.general_gamma = Eigen::Array<T, -1, -1 > :: Zero(nMoments, nPositions);
-#pragma omp barrier
-#pragma omp critical
-	Global.general_gamma += *gamma;
-#pragma omp barrier
+	Global.reduce(Global.general_gamma, *gamma);
     
     
 #pragma omp master
@@ -153,6 +153,9 @@ void Simulation<T,D>::Gaussian_Wave_Packet(){
   for(unsigned n = 0; n < unsigned(NumMoments); n++)
     m(n) = value_type((n == 0 ? 1 : 2 )*std::cyl_bessel_j(n, timestep )) * T(pow(-II,n));
     
+  // The ghosts of sum_ket are emptied after every time step, so the ones of phi may be left
+  // out of date between exchanges
+  phi.defer_exchange(true);
   for(int id = 0; id < NumDisorder; id++)
     {
       sum_ket.set_index(0);
@@ -205,6 +208,7 @@ void Simulation<T,D>::Gaussian_Wave_Packet(){
         }
 	
     }
+  phi.defer_exchange(false);
 
 #pragma omp critical
   {      
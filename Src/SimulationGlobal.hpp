@@ -15,6 +15,8 @@ private:
   // Regular quantities to calculate, such as DOS and CondXX
   Eigen::Array<double, -1, 1> singleshot_energies;
   double EnergyScale;
+  unsigned tile;
+  void tune_tile(char *);
 public:
   GlobalSimulation( char *);
 };
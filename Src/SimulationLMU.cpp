@@ -28,15 +28,7 @@ template <typename T,unsigned D>
 void Simulation<T,D>::store_LMU(Eigen::Array<T, -1, -1> *gamma){
     debug_message("Entered store_lmu\n");
 
-    long int nMoments   = gamma->rows();
-    long int nPositions = gamma->cols();
-
-#pragma omp master
-	Global.general_gamma = Eigen::Array<T, -1, -1 > :: Zero(nMoments, nPositions);
-#pragma omp barrier
-#pragma omp critical
-	Global.general_gamma += *gamma;
-#pragma omp barrier
+	Global.reduce(Global.general_gamma, *gamma);
     
     
 #pragma omp master
@@ -56,8 +48,9 @@ template <typename T,unsigned D>
 void Simulation<T,D>::LMU(int NDisorder, int NMoments, Eigen::Array<unsigned long, -1, 1> positions){
     debug_message("Entered Simulation::MU\n");
 
-    typedef typename extract_value_type<T>::value_type value_type;
-    Eigen::Matrix<T, 1, 2> tmp;
+    // The moments are accumulated in double precision when the vectors are stored in single precision
+    typedef typename extract_value_type<accumulator>::value_type accumulator_value;
+    Eigen::Matrix<accumulator, -1, 2> tmp;
     int NPositions = positions.size();
     unsigned long pos;
 
@@ -65,7 +58,7 @@ void Simulation<T,D>::LMU(int NDisorder, int NMoments, Eigen::Array<unsigned lon
     KPM_Vector<T,D> kpm1(2, *this); // left vector that will be Chebyshev-iterated on
 
     // initialize the local gamma matrix and set it to 0
-    Eigen::Array<T, -1, -1> gamma = Eigen::Array<T, -1, -1 >::Zero(NMoments, NPositions);
+    Eigen::Array<accumulator, -1, -1> gamma = Eigen::Array<accumulator, -1, -1 >::Zero(NMoments, NPositions);
 
     // start the kpm iteration
     Eigen::Array<long, -1, 1> average;
@@ -82,28 +75,30 @@ void Simulation<T,D>::LMU(int NDisorder, int NMoments, Eigen::Array<unsigned lon
             // have a starting vector different from zero
             pos = positions(pos_index);
             kpm0.build_site(pos);
-            kpm0.Exchange_Boundaries();
 
             kpm1.set_index(0);
             kpm1.v.col(0) = kpm0.v.col(0);
-            kpm0.empty_ghosts(0);
+            kpm1.invalidate_ghosts();          // Exchanged by the first multiplication that needs them
+            kpm1.light_cone(pos);
 
+            // The last multiplication of each pair also takes the products <0|T_n> and <0|T_n+1>
+            // over the interior of the domain, so the ghosts of kpm0 are not emptied
             for(int n = 0; n < NMoments; n+=2){
-                for(int i = n; i < n+2; i++)
-                    if(i!=0) cheb_iteration(&kpm1, i-1);
-
-              
-                tmp.setZero();
-                for(std::size_t ii = 0; ii < r.Sized ; ii += r.Ld[0])
-                    tmp += kpm0.v.block(ii,0, r.Ld[0], 1).adjoint() * kpm1.v.block(ii, 0, r.Ld[0], 2);
-
-                gamma(n, pos_index) += (tmp(0,0) - gamma(n, pos_index))/value_type(average(pos_index) + 1);			
-                gamma(n+1, pos_index) += (tmp(0,1) - gamma(n+1, pos_index))/value_type(average(pos_index) + 1);			
+                if(n == 0)
+                    kpm1.template Multiply<0>(kpm0.v.data(), tmp);
+                else {
+                    kpm1.template Multiply<1>();
+                    kpm1.template Multiply<1>(kpm0.v.data(), tmp);
+                }
+
+                gamma(n, pos_index) += (tmp(0,0) - gamma(n, pos_index))/accumulator_value(average(pos_index) + 1);			
+                gamma(n+1, pos_index) += (tmp(0,1) - gamma(n+1, pos_index))/accumulator_value(average(pos_index) + 1);			
             }
             average(pos_index)++;
         } 
     }
-    store_LMU(&gamma);
+    Eigen::Array<T, -1, -1> gamma_T = gamma.template cast<T>();
+    store_LMU(&gamma_T);
     debug_message("Left Simulation::MU\n");
 }
 
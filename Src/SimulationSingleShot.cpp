@@ -140,7 +140,7 @@ void Simulation<T,D>::singleshot(Eigen::Array<double, -1, 1> energies,
   int NDisorder, int NRandomV, std::string direction_string){
   // Calculate the longitudinal dc conductivity for a single value of the energy
     
-  T tmp = assign_value(0.,0.);
+  accumulator tmp = 0;   // The dot products are formed and summed in double precision for single precision vectors
   debug_message("Entered Single_Shot\n");
     
   // Obtain the relevant quantities from the queue
@@ -187,15 +187,24 @@ void Simulation<T,D>::singleshot(Eigen::Array<double, -1, 1> energies,
   // initialize the conductivity array
 
 #if (SSPRINT == 0)
-  KPM_Vector<T,D> phi (2, *this);
+  KPM_Vector<T,D> phi (MEMORY, *this);
+
+  // Consecutive jobs that preserve the disorder share a single Chebyshev recursion,
+  // so phi0 and phi1 hold one weighted sum for each energy of the largest batch
+  int max_batch = 1;
+  for(int job_index = 0, N_batch = 1; job_index < N_energies; job_index++){
+    N_batch = (job_index > 0 && preserve_disorders(job_index) != 0) ? N_batch + 1 : 1;
+    max_batch = std::max(max_batch, N_batch);
+  }
+  KPM_Vector<T,D> phi0(max_batch, *this);
+  KPM_Vector<T,D> phi1(max_batch, *this);
 #elif (SSPRINT != 0)
   KPM_Vector<T,D> phir1 (2, *this);
   KPM_Vector<T,D> phir2 (2, *this);
-#endif
-
 
   KPM_Vector<T,D> phi0(1, *this);
   KPM_Vector<T,D> phi1(1, *this);
+#endif
   // iteration over each energy
 
 #if (SSPRINT != 0)
@@ -215,18 +224,23 @@ void Simulation<T,D>::singleshot(Eigen::Array<double, -1, 1> energies,
 #endif
   long average = 0;
   double job_energy, job_gamma, job_preserve_disorder;
+#if (SSPRINT != 0)
   int job_NMoments;
+#endif
+  int N_batch = 1;
   for(int disorder = 0; disorder < NDisorder; disorder++){
     h.generate_disorder();
     h.build_velocity(indices.at(0),0u);
     h.build_velocity(indices.at(1),1u);
 
     // iteration over each energy and gammma
-    for(int job_index = 0; job_index < N_energies; job_index++){
+    for(int job_index = 0; job_index < N_energies; job_index += N_batch){
       job_energy = energies(job_index);
       job_gamma = gammas(job_index);
       job_preserve_disorder = preserve_disorders(job_index);
+#if (SSPRINT != 0)
       job_NMoments = moments(job_index);
+#endif
       std::complex<double> energy(job_energy, job_gamma);
         
       if(job_preserve_disorder == 0){
@@ -235,6 +249,22 @@ void Simulation<T,D>::singleshot(Eigen::Array<double, -1, 1> energies,
         h.build_velocity(indices.at(1),1u);
       }
 
+#if (SSPRINT == 0)
+      // The jobs that follow and preserve the disorder only differ from this one in the
+      // weights of the Chebyshev vectors, so they are calculated in the same recursion
+      N_batch = 1;
+      while(job_index + N_batch < N_energies && preserve_disorders(job_index + N_batch) != 0)
+        N_batch++;
+
+      // weight of the Chebyshev vector n for each energy e of the batch
+      Eigen::Matrix<T, -1, -1> weights;
+      weights = Eigen::Matrix<T, -1, -1>::Zero(moments.segment(job_index, N_batch).maxCoeff(), N_batch);
+      for(int e = 0; e < N_batch; e++){
+        std::complex<double> energy_e(energies(job_index + e), gammas(job_index + e));
+        for(int n = 0; n < moments(job_index + e); n++)
+          weights(n, e) = T(green(n, 1, energy_e).imag()/(1.0 + int(n==0)));
+      }
+#endif
 
       long average_R = average;
       // iteration over disorder and the number of random vectors
@@ -245,47 +275,36 @@ void Simulation<T,D>::singleshot(Eigen::Array<double, -1, 1> energies,
         // initialize the random vector
         phi0.initiate_vector();					
         phi0.Exchange_Boundaries(); 	
-        phi1.v.col(0).setZero();
 
             
-        // calculate the left KPM vector
+        // calculate the left KPM vectors
         phi.set_index(0);				
         generalized_velocity(&phi, &phi0, indices, 0);      // |phi> = v |phi_0>
-
-
-        for(int n = 0; n < job_NMoments; n++){		
-          if(n!=0) cheb_iteration(&phi, n-1);
-
-          phi1.v.col(0) += phi.v.col(phi.get_index())
-            *green(n, 1, energy).imag()/(1.0 + int(n==0));
-        }
+        cheb_weighted_sum(&phi, weights, &phi1);
           
-        // multiply phi1 by the velocity operator again. 
+        // multiply each vector of phi1 by the velocity operator again. 
         // We need a temporary vector to mediate the operation, which will be |phi>
-        phi.v.col(0) = phi1.v.col(0);
-        phi.set_index(0);
-        phi.Exchange_Boundaries();
-        generalized_velocity(&phi1, &phi, indices, 1);
-        phi1.empty_ghosts(0);
+        for(int e = 0; e < N_batch; e++){
+          phi.v.col(0) = phi1.v.col(e);                     // The ghosts of the sums are already exchanged
+          phi.set_index(0);
+          phi1.set_index(e);
+          generalized_velocity(&phi1, &phi, indices, 1);
+          phi1.empty_ghosts(e);
+        }
         
           
         phi.set_index(0);			
         phi.v.col(0) = phi0.v.col(0);
-        phi0.v.col(0).setZero(); 
-
-        for(int n = 0; n < job_NMoments; n++){		
-          if(n!=0) cheb_iteration(&phi, n-1);
-
-          phi0.v.col(0) += phi.v.col(phi.get_index())
-            *green(n, 1, energy).imag()/(1.0 + int(n==0));
-        }
+        cheb_weighted_sum(&phi, weights, &phi0);
           
           
         // finally, the dot product of phi1 and phi0 yields the conductivity
-        tmp *= 0.;
-        for(std::size_t ii = 0; ii < r.Sized ; ii += r.Ld[0])
-          tmp += T(phi1.v.col(0).segment(ii,r.Ld[0]).adjoint() * phi0.v.col(0).segment(ii,r.Ld[0]));
-        cond_array(job_index) += (tmp - cond_array(job_index))/value_type(average_R+1);						
+        for(int e = 0; e < N_batch; e++){
+          tmp *= 0.;
+          for(std::size_t ii = 0; ii < r.Sized ; ii += r.Ld[0])
+            tmp += accumulator(phi1.v.col(e).segment(ii,r.Ld[0]).template cast<accumulator>().adjoint() * phi0.v.col(e).segment(ii,r.Ld[0]).template cast<accumulator>());
+          cond_array(job_index + e) += (T(tmp) - cond_array(job_index + e))/value_type(average_R+1);
+        }
         debug_message("Concluded SingleShot calculation for SSPRINT=0\n");
 #elif (SSPRINT != 0)
 #pragma omp master
@@ -305,6 +324,7 @@ void Simulation<T,D>::singleshot(Eigen::Array<double, -1, 1> energies,
 
         phir2.v.col(0) = phi0.v.col(0);
         generalized_velocity(&phir1, &phi0, indices, 0);      // |phi> = v |phi_0>
+        phir1.refresh_ghosts();                               // phi1 sums the whole columns, ghosts included
         // from here on, phi0 is free to be used elsewhere, it is no longer needed
         phi0.v.col(0).setZero();
 
@@ -374,20 +394,9 @@ void Simulation<T,D>::singleshot(Eigen::Array<double, -1, 1> energies,
   // Now let's store the gamma matrix. Now we're going to use the 
   // property that gamma is hermitian: gamma_nm=gamma_mn*
     
-#pragma omp master
-  { 
-    Global.singleshot_cond = Eigen::Matrix<T, -1, -1> :: Zero(1, N_energies);
-  }
-#pragma omp barrier
-    
-    
   //std::cout << "IMPORTANT ! ! !:\n V is not hermitian. Make sure you take this into account\n";
   // in this case there's no problem. both V are anti-hermitic, so the minus signs cancel
-#pragma omp critical
-  {
-    Global.singleshot_cond += cond_array;			
-  }
-#pragma omp barrier
+  Global.reduce(Global.singleshot_cond, cond_array);
     
     
 #pragma omp master
@@ -420,6 +429,28 @@ void Simulation<T,D>::singleshot(Eigen::Array<double, -1, 1> energies,
 #pragma omp barrier
 }
 
+template <typename T, unsigned D>
+void Simulation<T,D>::cheb_weighted_sum(KPM_Vector<T,D>* kpm, Eigen::Matrix<T, -1, -1> & weights, KPM_Vector<T,D>* sum){
+  // Runs the Chebyshev recursion starting from the current vector of kpm (which must be
+  // at index 0) and stores sum_n weights(n,e) T_n(H)|kpm> in the column e of sum.
+  // The Chebyshev vectors fill the memory of kpm before being added to the sums, 
+  // so that all the energies are updated with a single matrix product
+  int N_moments = weights.rows();
+  int mem = kpm->v.cols();
+  sum->v.leftCols(weights.cols()).setZero();
+
+  // The sums are taken over the whole columns, so their ghosts are up to date as well
+  kpm->refresh_ghosts();
+
+  for(int n0 = 0; n0 < N_moments; n0 += mem){
+    int nb = std::min(mem, N_moments - n0);
+    for(int n = std::max(n0, 1); n < n0 + nb; n++)
+      cheb_iteration(kpm, n-1);
+
+    sum->v.leftCols(weights.cols()).noalias() += kpm->v.leftCols(nb) * weights.middleRows(n0, nb);
+  }
+}
+
 template class Simulation<float ,1u>;
 template class Simulation<double ,1u>;
 template class Simulation<long double ,1u>;
@@ -0,0 +1,178 @@
+/***********************************************************/
+/*                                                         */
+/*   Copyright (C) 2018-2021, M. Andelkovic, L. Covaci,    */
+/*  A. Ferreira, S. M. Joao, J. V. Lopes, T. G. Rappoport  */
+/*                                                         */
+/***********************************************************/
+
+#include "Generic.hpp"
+#include "ComplexTraits.hpp"
+#include "StencilKernels.hpp"
+
+#if SIMD_KERNELS && defined(__x86_64__) && defined(__GNUC__) && !defined(__clang__)
+#define STENCIL_X86 1
+#include <immintrin.h>
+#else
+#define STENCIL_X86 0
+#endif
+
+#if STENCIL_X86
+/*
+  The kernels are compiled for their instruction set with the target pragmas, independently of the
+  flags used for the rest of the code. Contraction into fused multiply-adds is turned off to keep
+  the results identical to the generic code on every machine.
+*/
+
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#pragma GCC optimize("fp-contract=off")
+namespace stencil_avx2 {
+  struct complex_double {
+    typedef double value_type;
+    typedef __m256d reg;
+    static const unsigned W = 2;
+    static inline reg set1(double x)                 { return _mm256_set1_pd(x); }
+    static inline reg load(const double * p)         { return _mm256_loadu_pd(p); }
+    static inline void store(double * p, reg x)      { _mm256_storeu_pd(p, x); }
+    static inline reg add(reg x, reg y)              { return _mm256_add_pd(x, y); }
+    static inline reg mul(reg x, reg y)              { return _mm256_mul_pd(x, y); }
+    static inline reg addsub(reg x, reg y)           { return _mm256_addsub_pd(x, y); }
+    static inline reg swap(reg x)                    { return _mm256_permute_pd(x, 0x5); }
+    static inline reg onsite(const double * U)       { return _mm256_permute4x64_pd(_mm256_castpd128_pd256(_mm_loadu_pd(U)), 0x50); }
+  };
+  struct complex_float {
+    typedef float value_type;
+    typedef __m256 reg;
+    static const unsigned W = 4;
+    static inline reg set1(float x)                  { return _mm256_set1_ps(x); }
+    static inline reg load(const float * p)          { return _mm256_loadu_ps(p); }
+    static inline void store(float * p, reg x)       { _mm256_storeu_ps(p, x); }
+    static inline reg add(reg x, reg y)              { return _mm256_add_ps(x, y); }
+    static inline reg mul(reg x, reg y)              { return _mm256_mul_ps(x, y); }
+    static inline reg addsub(reg x, reg y)           { return _mm256_addsub_ps(x, y); }
+    static inline reg swap(reg x)                    { return _mm256_permute_ps(x, 0xB1); }
+    static inline reg onsite(const float * U)        { return _mm256_permutevar8x32_ps(_mm256_castps128_ps256(_mm_loadu_ps(U)), _mm256_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3)); }
+  };
+#include "StencilKernelsRow.hpp"
+}
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+#pragma GCC optimize("fp-contract=off")
+namespace stencil_avx512 {
+  struct complex_double {
+    typedef double value_type;
+    typedef __m512d reg;
+    static const unsigned W = 4;
+    static inline reg set1(double x)                 { return _mm512_set1_pd(x); }
+    static inline reg load(const double * p)         { return _mm512_loadu_pd(p); }
+    static inline void store(double * p, reg x)      { _mm512_storeu_pd(p, x); }
+    static inline reg add(reg x, reg y)              { return _mm512_add_pd(x, y); }
+    static inline reg mul(reg x, reg y)              { return _mm512_mul_pd(x, y); }
+    static inline reg addsub(reg x, reg y)           { return _mm512_mask_sub_pd(_mm512_add_pd(x, y), 0x55, x, y); }
+    static inline reg swap(reg x)                    { return _mm512_permute_pd(x, 0x55); }
+    static inline reg onsite(const double * U)       { return _mm512_permutexvar_pd(_mm512_set_epi64(3, 3, 2, 2, 1, 1, 0, 0), _mm512_castpd256_pd512(_mm256_loadu_pd(U))); }
+  };
+  struct complex_float {
+    typedef float value_type;
+    typedef __m512 reg;
+    static const unsigned W = 8;
+    static inline reg set1(float x)                  { return _mm512_set1_ps(x); }
+    static inline reg load(const float * p)          { return _mm512_loadu_ps(p); }
+    static inline void store(float * p, reg x)       { _mm512_storeu_ps(p, x); }
+    static inline reg add(reg x, reg y)              { return _mm512_add_ps(x, y); }
+    static inline reg mul(reg x, reg y)              { return _mm512_mul_ps(x, y); }
+    static inline reg addsub(reg x, reg y)           { return _mm512_mask_sub_ps(_mm512_add_ps(x, y), 0x5555, x, y); }
+    static inline reg swap(reg x)                    { return _mm512_permute_ps(x, 0xB1); }
+    static inline reg onsite(const float * U)        { return _mm512_permutexvar_ps(_mm512_set_epi32(7, 7, 6, 6, 5, 5, 4, 4, 3, 3, 2, 2, 1, 1, 0, 0), _mm512_castps256_ps512(_mm256_loadu_ps(U))); }
+  };
+#include "StencilKernelsRow.hpp"
+}
+#pragma GCC pop_options
+#endif
+
+namespace {
+  // 0: generic code, 1: AVX2, 2: AVX-512
+  unsigned stencil_isa()
+  {
+#if STENCIL_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx512f"))
+      return 2;
+    if(__builtin_cpu_supports("avx2"))
+      return 1;
+#endif
+    return 0;
+  }
+
+  const char * stencil_isa_name()
+  {
+    const char * names[] = {"generic", "AVX2", "AVX-512"};
+    return names[stencil_isa()];
+  }
+
+  template <typename T, class V>
+  std::size_t stencil_row_complex(std::complex<T> * phi0, const std::complex<T> * phiM1, const std::complex<T> * phiM2,
+                                  std::size_t n, bool init, unsigned mult, const T * U, unsigned nhop,
+                                  const std::complex<T> * t, const std::ptrdiff_t * d)
+  {
+    // std::complex<T> is guaranteed to be laid out as T[2]
+    return V::template row<T>(reinterpret_cast<T*>(phi0), reinterpret_cast<const T*>(phiM1), reinterpret_cast<const T*>(phiM2),
+                              n, init, mult, U, nhop, reinterpret_cast<const T*>(t), d);
+  }
+
+#if STENCIL_X86
+  struct avx2 {
+    template <typename T>
+    static std::size_t row(T * phi0, const T * phiM1, const T * phiM2, std::size_t n, bool init, unsigned mult,
+                           const T * U, unsigned nhop, const T * t, const std::ptrdiff_t * d)
+    {
+      typedef typename std::conditional<std::is_same<T, double>::value,
+                                        stencil_avx2::complex_double, stencil_avx2::complex_float>::type V;
+      return stencil_avx2::stencil_row<V>(phi0, phiM1, phiM2, n, init, mult, U, nhop, t, d);
+    }
+  };
+  struct avx512 {
+    template <typename T>
+    static std::size_t row(T * phi0, const T * phiM1, const T * phiM2, std::size_t n, bool init, unsigned mult,
+                           const T * U, unsigned nhop, const T * t, const std::ptrdiff_t * d)
+    {
+      typedef typename std::conditional<std::is_same<T, double>::value,
+                                        stencil_avx512::complex_double, stencil_avx512::complex_float>::type V;
+      return stencil_avx512::stencil_row<V>(phi0, phiM1, phiM2, n, init, mult, U, nhop, t, d);
+    }
+  };
+#endif
+
+  template <typename T>
+  typename StencilKernels<std::complex<T>>::row_kernel select_complex_row()
+  {
+    switch(stencil_isa())
+      {
+#if STENCIL_X86
+      case 2:
+        return &stencil_row_complex<T, avx512>;
+      case 1:
+        return &stencil_row_complex<T, avx2>;
+#endif
+      default:
+        return nullptr;
+      }
+  }
+}
+
+template <typename T>
+const typename StencilKernels<T>::row_kernel StencilKernels<T>::row = nullptr;
+template <typename T>
+const char * const StencilKernels<T>::isa = "generic";
+
+template <> const StencilKernels<std::complex<float>>::row_kernel StencilKernels<std::complex<float>>::row = select_complex_row<float>();
+template <> const StencilKernels<std::complex<double>>::row_kernel StencilKernels<std::complex<double>>::row = select_complex_row<double>();
+template <> const char * const StencilKernels<std::complex<float>>::isa = stencil_isa_name();
+template <> const char * const StencilKernels<std::complex<double>>::isa = stencil_isa_name();
+
+template struct StencilKernels<float>;
+template struct StencilKernels<double>;
+template struct StencilKernels<long double>;
+template struct StencilKernels<std::complex<long double>>;
@@ -0,0 +1,31 @@
+/***********************************************************/
+/*                                                         */
+/*   Copyright (C) 2018-2021, M. Andelkovic, L. Covaci,    */
+/*  A. Ferreira, S. M. Joao, J. V. Lopes, T. G. Rappoport  */
+/*                                                         */
+/***********************************************************/
+
+/*
+  Explicitly vectorized versions of the fused tile-row stencil used by KPM_VectorBasis::stencil_row.
+  The compiler does not vectorize std::complex arithmetic by itself, so the complex types get hand
+  written AVX2 and AVX-512 kernels. The instruction set is detected once at start up, so that the
+  same binary runs on machines with and without AVX-512.
+
+  row(phi0, phiM1, phiM2, n, init, MULT, U, nhop, t, d) processes the first elements of the row
+  and returns how many it has processed; the remaining ones are left to the generic code.
+  row is null when there is no kernel for the type T or the CPU does not support it.
+*/
+
+template <typename T>
+struct StencilKernels {
+  typedef typename extract_value_type<T>::value_type value_type;
+  typedef std::size_t (*row_kernel)(T *, const T *, const T *, std::size_t, bool, unsigned,
+                                    const value_type *, unsigned, const T *, const std::ptrdiff_t *);
+  static const row_kernel row;
+  static const char * const isa;
+};
+
+template <> const StencilKernels<std::complex<float>>::row_kernel StencilKernels<std::complex<float>>::row;
+template <> const StencilKernels<std::complex<double>>::row_kernel StencilKernels<std::complex<double>>::row;
+template <> const char * const StencilKernels<std::complex<float>>::isa;
+template <> const char * const StencilKernels<std::complex<double>>::isa;
@@ -0,0 +1,66 @@
+/***********************************************************/
+/*                                                         */
+/*   Copyright (C) 2018-2021, M. Andelkovic, L. Covaci,    */
+/*  A. Ferreira, S. M. Joao, J. V. Lopes, T. G. Rappoport  */
+/*                                                         */
+/***********************************************************/
+
+/*
+  Body of the vectorized tile-row stencil. It is included once for every instruction set by
+  StencilKernels.cpp, inside a region compiled for that instruction set, and works with any
+  set of vector operations V:
+     V::W              number of complex numbers in a register
+     V::set1(x)        all the lanes equal to x
+     V::load/store     unaligned load/store of W complex numbers (interleaved real and imaginary)
+     V::onsite(U)      the W real numbers U[0..W-1], each one repeated for the real and imaginary lanes
+     V::swap(x)        exchanges the real and imaginary parts
+     V::addsub(x, y)   x - y in the real lanes and x + y in the imaginary lanes
+  The operations are done in the same order as in KPM_VectorBasis::stencil_block,
+  so the results are the same as the ones of the generic code.
+*/
+
+template <class V>
+std::size_t stencil_row(typename V::value_type * phi0, const typename V::value_type * phiM1,
+                        const typename V::value_type * phiM2, std::size_t n, bool init, unsigned mult,
+                        const typename V::value_type * U, unsigned nhop,
+                        const typename V::value_type * t, const std::ptrdiff_t * d)
+{
+  typedef typename V::value_type value_type;
+  typedef typename V::reg reg;
+  const unsigned R = 4;                   // Registers kept in flight per block
+  const std::size_t B = R * V::W;          // Complex numbers per block
+  const reg m2 = V::set1(- value_type(mult));
+  const reg m1 = V::set1(value_type(mult + 1));
+
+  std::size_t k0 = 0;
+  for(; k0 + B <= n; k0 += B)
+    {
+      reg acc[R];
+      if(init)
+        for(unsigned r = 0; r < R; r++)
+          acc[r] = V::mul(m2, V::load(phiM2 + 2 * (k0 + r * V::W)));
+      else
+        for(unsigned r = 0; r < R; r++)
+          acc[r] = V::load(phi0 + 2 * (k0 + r * V::W));
+
+      if(U != nullptr)
+        for(unsigned r = 0; r < R; r++)
+          acc[r] = V::add(acc[r], V::mul(V::mul(m1, V::load(phiM1 + 2 * (k0 + r * V::W))), V::onsite(U + k0 + r * V::W)));
+
+      for(unsigned ib = 0; ib < nhop; ib++)
+        {
+          const reg tr = V::set1(t[2 * ib]);
+          const reg ti = V::set1(t[2 * ib + 1]);
+          const value_type * p = phiM1 + 2 * (std::ptrdiff_t(k0) + d[ib]);
+          for(unsigned r = 0; r < R; r++)
+            {
+              const reg x = V::load(p + 2 * r * V::W);
+              acc[r] = V::add(acc[r], V::addsub(V::mul(tr, x), V::mul(ti, V::swap(x))));
+            }
+        }
+
+      for(unsigned r = 0; r < R; r++)
+        V::store(phi0 + 2 * (k0 + r * V::W), acc[r]);
+    }
+  return k0;
+}
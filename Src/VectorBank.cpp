@@ -0,0 +1,62 @@
+/***********************************************************/
+/*                                                         */
+/*   Copyright (C) 2018-2021, M. Andelkovic, L. Covaci,    */
+/*  A. Ferreira, S. M. Joao, J. V. Lopes, T. G. Rappoport  */
+/*                                                         */
+/***********************************************************/
+
+#include "Generic.hpp"
+#include "VectorBank.hpp"
+#include <sys/mman.h>
+#include <unistd.h>
+
+template <typename T>
+VectorBank<T>::VectorBank(std::size_t size, std::size_t columns, unsigned nblock, bool out_of_core) :
+  n(size), ncols(columns), NBlock(nblock), mapped(nullptr), bytes(sizeof(T) * size * columns) {
+  if(!out_of_core){
+    ram.resize(n * ncols);
+    return;
+  }
+
+  const char * dir = getenv("TMPDIR");
+  std::string name = std::string(dir != nullptr ? dir : "/tmp") + "/kite_bank_XXXXXX";
+  std::vector<char> path(name.begin(), name.end());
+  path.push_back('\0');
+
+  int fd = mkstemp(path.data());
+  if(fd == -1){
+    std::cout << "Could not create the scratch file " << name << " for the vector bank. Exiting.\n";
+    exit(1);
+  }
+  unlink(path.data());
+  if(ftruncate(fd, bytes) != 0){
+    std::cout << "Could not reserve " << bytes << " bytes in " << path.data() << " for the vector bank. Exiting.\n";
+    exit(1);
+  }
+  void * p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if(p == MAP_FAILED){
+    std::cout << "Could not map the scratch file of the vector bank. Exiting.\n";
+    exit(1);
+  }
+  mapped = static_cast<T*>(p);
+}
+
+template <typename T>
+VectorBank<T>::~VectorBank() {
+  if(mapped != nullptr)
+    munmap(mapped, bytes);
+}
+
+template <typename T>
+Eigen::Map<Eigen::Matrix<T, -1, -1>, 0, Eigen::Stride<-1, -1>> VectorBank<T>::block_vector(unsigned ib, std::size_t i, std::size_t m, int c, int k) {
+  // View of the vector ib of the block restricted to the sites [i, i + m) and to the columns [c, c + k), as KPM_VectorBasis::block_vector
+  return Eigen::Map<Eigen::Matrix<T, -1, -1>, 0, Eigen::Stride<-1, -1>>(col(c) + i * NBlock + ib, m, k, Eigen::Stride<-1, -1>(n, NBlock));
+}
+
+template class VectorBank<float>;
+template class VectorBank<double>;
+template class VectorBank<long double>;
+template class VectorBank<std::complex<float>>;
+template class VectorBank<std::complex<double>>;
+template class VectorBank<std::complex<long double>>;
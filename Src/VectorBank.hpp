@@ -0,0 +1,32 @@
+/***********************************************************/
+/*                                                         */
+/*   Copyright (C) 2018-2021, M. Andelkovic, L. Covaci,    */
+/*  A. Ferreira, S. M. Joao, J. V. Lopes, T. G. Rappoport  */
+/*                                                         */
+/***********************************************************/
+
+/*
+  Bank of ncols KPM vectors of n elements, each vector stored as a column. It lets a Chebyshev
+  recursion be computed once and its vectors read back as many times as needed. The columns are
+  kept in memory, or in a scratch file mapped in memory when they do not fit: the operating system
+  then moves them to disk and back as they are used. The scratch file is created in $TMPDIR (/tmp
+  by default) and removed as soon as it is mapped, so nothing is left behind.
+*/
+
+template <typename T>
+class VectorBank {
+  std::size_t    n;
+  std::size_t    ncols;
+  unsigned       NBlock;     // Vectors of each column, interleaved site by site as in KPM_VectorBasis
+  std::vector<T> ram;
+  T            * mapped;
+  std::size_t    bytes;
+public:
+  VectorBank(std::size_t size, std::size_t columns, unsigned nblock, bool out_of_core);
+  ~VectorBank();
+  VectorBank(const VectorBank &) = delete;
+  VectorBank & operator=(const VectorBank &) = delete;
+
+  T * col(std::size_t c) { return (mapped != nullptr ? mapped : ram.data()) + c * n; }
+  Eigen::Map<Eigen::Matrix<T, -1, -1>, 0, Eigen::Stride<-1, -1>> block_vector(unsigned ib, std::size_t i, std::size_t m, int c, int k);
+};
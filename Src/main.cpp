@@ -10,8 +10,8 @@
 
 template<typename T, unsigned D>
 class Simulation;
-#include "Global.hpp"
 #include "ComplexTraits.hpp"
+#include "Global.hpp"
 #include "myHDF5.hpp"
 #include "Random.hpp"
 #include "Coordinates.hpp"
@@ -73,21 +73,24 @@ int main(int argc, char *argv[]){
 
   // Decide which version of the program should run. This depends on the
   // precision, the dimension and whether or not we want complex functions.
+  // The single precision versions (precision 0) only store the vectors in single
+  // precision: the moments and the dot products are accumulated in double precision
+  // (see accumulator_type in ComplexTraits.hpp)
   int index =   dim - 1 + 3 * precision + is_complex * 3 * 3; 
   switch (index ) {
   case 0:
     {
-      class GlobalSimulation <float, 1u> h(argv[1]); // float real 1D
+      class GlobalSimulation <float, 1u> h(argv[1]); // float real 1D, double accumulation
       break;
     }
   case 1:
     {
-      class GlobalSimulation <float, 2u> h(argv[1]); // float real 2D
+      class GlobalSimulation <float, 2u> h(argv[1]); // float real 2D, double accumulation
       break;
     }
   case 2:
     {
-      class GlobalSimulation <float, 3u> h(argv[1]); // float real 3D
+      class GlobalSimulation <float, 3u> h(argv[1]); // float real 3D, double accumulation
       break;
     }
   case 3:
@@ -47,6 +47,8 @@ void print_flags_message(){
   verbose_message("Flags set at compilation:\n");
   verbose_message("DEBUG: "); verbose_message(DEBUG); verbose_message("\n");
   verbose_message("VERBOSE: "); verbose_message(VERBOSE); verbose_message("\n");
+  verbose_message("SIMD_KERNELS: "); verbose_message(SIMD_KERNELS); verbose_message(" (");
+  verbose_message(StencilKernels<std::complex<double>>::isa); verbose_message(")\n");
   //verbose_message("ESTIMATE_TIME: "); verbose_message(ESTIMATE_TIME); verbose_message("\n");
   verbose_message("-------------------------\n");
 }
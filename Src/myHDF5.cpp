@@ -82,6 +82,75 @@ typename std::enable_if<is_tt<std::complex, T>::value, void>::type write_hdf5(co
 
 
 
+/*
+  The dataset is created with cols columns the first time, and every call fills a hyperslab of it,
+  so a large array can be written in pieces without ever being held whole in memory. As in
+  write_hdf5, the columns of the array are the rows of the dataset.
+*/
+template <typename T>
+typename std::enable_if<!is_tt<std::complex, T>::value, void>::type write_hdf5_columns(const Eigen::Array<T, -1, -1 > & mu,
+                                                                                       H5::H5File * file,
+                                                                                       const std::string name,
+                                                                                       hsize_t cols, hsize_t col) {
+  hsize_t    dims[2], count[2], offset[2];
+  dims[0]   = cols;
+  dims[1]   = count[1] = mu.rows();
+  count[0]  = mu.cols();
+  offset[0] = col;
+  offset[1] = 0;
+  H5::DataSet dataset;
+  H5::DataSpace dataspace = H5::DataSpace(2, dims);
+  
+  try {
+    H5::Exception::dontPrint();
+    dataset = file->createDataSet(name, DataTypeFor<T>::value, dataspace);
+  }
+  catch (H5::FileIException & E) { 
+    dataset = file->openDataSet(name);
+  }
+
+  H5::DataSpace filespace = dataset.getSpace();
+  filespace.selectHyperslab(H5S_SELECT_SET, count, offset);
+  H5::DataSpace memspace = H5::DataSpace(2, count);
+  dataset.write(mu.data(), DataTypeFor<T>::value, memspace, filespace);
+}
+
+
+template <typename T>
+typename std::enable_if<is_tt<std::complex, T>::value, void>::type write_hdf5_columns(const Eigen::Array<T, -1, -1 > & mu,
+                                                                                      H5::H5File * file,
+                                                                                      const std::string name,
+                                                                                      hsize_t cols, hsize_t col) {
+  hsize_t    dims[2], count[2], offset[2];
+  dims[0]   = cols;
+  dims[1]   = count[1] = mu.rows();
+  count[0]  = mu.cols();
+  offset[0] = col;
+  offset[1] = 0;
+  H5::DataSet dataset;
+  H5::DataSpace dataspace = H5::DataSpace(2, dims);
+  typedef typename extract_value_type<T>::value_type value_type;
+  
+  H5::CompType complex_datatype(sizeof(T));
+  complex_datatype.insertMember("r", 0, DataTypeFor<value_type>::value);
+  complex_datatype.insertMember( "i", sizeof(value_type), DataTypeFor<value_type>::value);
+  
+  try {
+    H5::Exception::dontPrint();
+    dataset = file->createDataSet(name, complex_datatype, dataspace);
+  }
+  catch (H5::FileIException & E) { 
+    dataset = file->openDataSet(name);
+  }
+
+  H5::DataSpace filespace = dataset.getSpace();
+  filespace.selectHyperslab(H5S_SELECT_SET, count, offset);
+  H5::DataSpace memspace = H5::DataSpace(2, count);
+  dataset.write(mu.data(), complex_datatype, memspace, filespace);
+}
+
+
+
 template <typename T> 
 void instantiateHDF<T>:: get_hdf5A(T *l, H5::H5File *file,  std::string & name) {
   get_hdf5<T>(l, file, name);
@@ -97,6 +166,11 @@ void instantiateHDF<T>:: write_hdf5A(const Eigen::Array<T, -1, -1 > & mu, H5::H5
   write_hdf5<T>(mu, file, name);
 }
 
+template <typename T> 
+void instantiateHDF<T>:: write_hdf5_columnsA(const Eigen::Array<T, -1, -1 > & mu, H5::H5File * file, const std::string name, hsize_t cols, hsize_t col) {
+  write_hdf5_columns<T>(mu, file, name, cols, col);
+}
+
 template struct instantiateHDF<int>;
 template struct instantiateHDF<unsigned>;
 template struct instantiateHDF<unsigned long>;
@@ -71,9 +71,17 @@ typename std::enable_if<!is_tt<std::complex, T>::value, void>::type write_hdf5(c
 template <typename T>
 typename std::enable_if<is_tt<std::complex, T>::value, void>::type write_hdf5(const Eigen::Array<T, -1, -1 > &, H5::H5File *, const std::string);
 
+// Writes the columns of an array as the columns col, col+1, ... of a dataset with cols columns
+template <typename T>
+typename std::enable_if<!is_tt<std::complex, T>::value, void>::type write_hdf5_columns(const Eigen::Array<T, -1, -1 > &, H5::H5File *, const std::string, hsize_t, hsize_t);
+
+template <typename T>
+typename std::enable_if<is_tt<std::complex, T>::value, void>::type write_hdf5_columns(const Eigen::Array<T, -1, -1 > &, H5::H5File *, const std::string, hsize_t, hsize_t);
+
 template <typename T>
 struct instantiateHDF {
   void write_hdf5A(const Eigen::Array<T, -1, -1 > &, H5::H5File *, const std::string);
+  void write_hdf5_columnsA(const Eigen::Array<T, -1, -1 > &, H5::H5File *, const std::string, hsize_t, hsize_t);
   void get_hdf5A(T *, H5::H5File *,  std::string &);
   void get_hdf5A(T *, H5::H5File *,  char *);
 };
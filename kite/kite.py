@@ -352,7 +352,9 @@ class StructuralDisorder:
 # needs to be same as the number of orbitals at a given atom), and takes care of the conversion to the c++ orbital-only
 # format.
 class Disorder:
-    def __init__(self, lattice):
+    def __init__(self, lattice, on_the_fly=False):
+        # the gaussian and uniform energies are recomputed during every multiplication, instead of being stored
+        self._on_the_fly = int(on_the_fly)
         # type of the disorder, can be 'Gaussian', 'Uniform' and 'Deterministic'.
         self._type = []
         # type_id of the disorder, can be 'Gaussian': 1, 'Uniform': 2 and 'Deterministic': 3.
@@ -756,7 +758,8 @@ class Calculation:
 class Configuration:
 
     def __init__(self, divisions=(1, 1, 1), length=(1, 1, 1), boundaries=(False, False, False),
-                 is_complex=False, precision=1, spectrum_range=None):
+                 is_complex=False, precision=1, spectrum_range=None, tile=None, team=None, memory=None,
+                 memory_budget=None, vector_bank=None, num_randoms_block=None):
         """Define basic parameters used in the calculation
 
        Parameters
@@ -776,6 +779,25 @@ class Configuration:
             Energy scale which defines the scaling factor of all the energy related parameters. The scaling is done
             automatically in the background after this definition. If the term is not specified, a rough estimate of the
             bounds is found.
+       tile : Optional[int]
+            Linear size of the tiles in which each decomposed part is swept. The size of each part in every direction
+            must be a multiple of it. 0 tries the powers of two between 8 and 256 at run time and keeps the fastest one.
+            If not specified, the TILE chosen when compiling the C++ code is used.
+       team : Optional[int]
+            Number of threads that share the tiles of each decomposed part. 0 uses the processors left over by the
+            decomposition. If not specified, each part is computed by a single thread.
+       memory : Optional[int]
+            Number of Chebyshev vectors kept in memory by the two and three dimensional Gamma matrices (conductivities).
+            It must be at least 2, or 0 to choose it from memory_budget. If not specified, the MEMORY chosen when
+            compiling the C++ code is used.
+       memory_budget : Optional[float]
+            Memory in MB that the vectors of memory=0 may take in all the threads together. If not specified, half of
+            the physical memory is used.
+       vector_bank : Optional[int]
+            Keep the right Chebyshev vectors of the conductivities once computed, instead of iterating them again for
+            every block of left vectors: 0 - no, 1 - in memory, 2 - in a scratch file.
+       num_randoms_block : Optional[int]
+            Number of random vectors propagated together through the Chebyshev iteration.
        """
 
         if spectrum_range:
@@ -802,6 +824,20 @@ class Configuration:
         self._htype = np.float32
         self.set_type()
 
+        if vector_bank is not None and vector_bank not in (0, 1, 2):
+            raise SystemExit('vector_bank should be 0, 1 or 2')
+        if memory is not None and memory == 1:
+            raise SystemExit('memory should be at least 2, or 0 to choose it from memory_budget')
+        if num_randoms_block is not None and num_randoms_block < 1:
+            raise SystemExit('num_randoms_block should be positive')
+
+        self._tile = tile
+        self._team = team
+        self._memory = memory
+        self._memory_budget = memory_budget
+        self._vector_bank = vector_bank
+        self._num_randoms_block = num_randoms_block
+
     def set_type(self, ):
         if self._is_complex == 0:
             if self._precision == 0:
@@ -861,6 +897,37 @@ class Configuration:
         """Return the type of the Hamiltonian complex or real, and float, double or long double. """
         return self._htype
 
+    @property
+    def tile(self):  # -> tile:
+        """Returns the tile size, 0 if it is tuned at run time, or None to use the compiled one. """
+        return self._tile
+
+    @property
+    def team(self):  # -> team:
+        """Returns the number of threads of each decomposed part, or None for one thread. """
+        return self._team
+
+    @property
+    def memory(self):  # -> memory:
+        """Returns the number of Chebyshev vectors kept in memory, 0 if chosen at run time, or None to use the
+        compiled one. """
+        return self._memory
+
+    @property
+    def memory_budget(self):  # -> memory_budget:
+        """Returns the memory in MB available to the Chebyshev vectors when memory=0. """
+        return self._memory_budget
+
+    @property
+    def vector_bank(self):  # -> vector_bank:
+        """Returns where the right Chebyshev vectors are kept, 0 - not kept, 1 - in memory, 2 - in a scratch file. """
+        return self._vector_bank
+
+    @property
+    def num_randoms_block(self):  # -> num_randoms_block:
+        """Returns the number of random vectors propagated together. """
+        return self._num_randoms_block
+
 
 def make_pybinding_model(lattice, disorder=None, disorder_structural=None, **kwargs):
     """Build a Pybinding model with disorder used in Kite. Bond disorder or magnetic field are not currently supported.
@@ -1324,9 +1391,22 @@ def config_system(lattice, config, calculation, modification=None, **kwargs):
           '\nYou should choose at most the number of processor cores you have.'
           '\nWARNING: System size need\'s to be an integer multiple of \n'
           '[TILE * ', domain_dec, '] '
-          '\nwhere TILE is selected when compiling the C++ code. \n')
+          '\nwhere TILE is the tile of the Configuration, or the one selected when compiling the C++ code. \n')
 
     f.create_dataset('Divisions', data=domain_dec[0:space_size], dtype='u4')
+    # optional settings of the parallelization and of the memory, the C++ defaults are kept when they are not set
+    if config.tile is not None:
+        f.create_dataset('Tile', data=config.tile, dtype='u4')
+    if config.team is not None:
+        f.create_dataset('Team', data=config.team, dtype='u4')
+    if config.memory is not None:
+        f.create_dataset('Memory', data=config.memory, dtype='u4')
+    if config.memory_budget is not None:
+        f.create_dataset('MemoryBudget', data=config.memory_budget, dtype=np.float64)
+    if config.vector_bank is not None:
+        f.create_dataset('VectorBank', data=config.vector_bank, dtype='u4')
+    if config.num_randoms_block is not None:
+        f.create_dataset('NumRandomsBlock', data=config.num_randoms_block, dtype='u4')
     # space dimension of the lattice 1D, 2D, 3D
     f.create_dataset('DIM', data=space_size, dtype='u4')
     # lattice vectors. Size is same as DIM
@@ -1400,6 +1480,7 @@ def config_system(lattice, config, calculation, modification=None, **kwargs):
                                dtype=np.float64)
         grp_dis.create_dataset('OnsiteDisorderMeanStdv', data=np.array(disorder._stdv) / config.energy_scale,
                                dtype=np.float64)
+        grp_dis.create_dataset('OnsiteDisorderOnTheFly', data=disorder._on_the_fly, dtype=np.int32)
     else:
         grp_dis.create_dataset('OnsiteDisorderModelType', (1, 0))
         grp_dis.create_dataset('OrbitalNum', (1, 0))
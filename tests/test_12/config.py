@@ -0,0 +1,41 @@
+import numpy as np
+import pybinding as pb
+import kite
+
+
+def graphene(onsite=(0, 0)):
+    theta = np.pi / 3
+    t = 1  # eV
+    a1 = np.array([1 + np.cos(theta), np.sin(theta)])
+    a2 = np.array([0, 2 * np.sin(theta)])
+    lat = pb.Lattice(
+        a1=a1, a2=a2
+    )
+    lat.add_sublattices(
+        # name, position, and onsite potential
+        ('A', [0, 0], onsite[0]),
+        ('B', [1, 0], onsite[1])
+    )
+    lat.add_hoppings(
+        ([0, 0], 'A', 'B', - t),
+        ([-1, 0], 'A', 'B', - t),
+        ([-1, 1], 'A', 'B', - t)
+    )
+
+    return lat
+
+
+lattice = graphene()
+W = 0.2
+disorder = kite.Disorder(lattice)
+disorder.add_disorder('A', 'Uniform', 0.0, W*0.5/np.sqrt(3))
+disorder.add_disorder('B', 'Uniform', 0.0, W*0.5/np.sqrt(3))
+nx = ny = 2
+lx = ly = 256
+# the right vectors are kept in a bank, and each of the four domains is computed by two threads.
+# The moments are the same as those of test_11
+configuration = kite.Configuration(divisions=[nx, ny], length=[lx, ly], boundaries=[True, True], is_complex=False, precision=1, spectrum_range=[-3.1, 3.1],
+                                   memory=16, num_randoms_block=2, vector_bank=1, team=2)
+calculation = kite.Calculation(configuration)
+calculation.conductivity_dc(num_points=1000, num_moments=64, num_random=2, num_disorder=1, direction='xx', temperature=0.01)
+kite.config_system(lattice, configuration, calculation, disorder=disorder, filename='config.h5')
@@ -0,0 +1,45 @@
+import kite
+import numpy as np
+import pybinding as pb
+
+
+def square_lattice(onsite):
+    """Make a square lattice with nearest neighbor hopping"""
+
+    a1 = np.array([1, 0])
+    a2 = np.array([0, 1])
+
+    # create a lattice with 2 primitive vectors
+    lat = pb.Lattice(
+        a1=a1, a2=a2
+    )
+
+    # Add sublattices
+    lat.add_sublattices(
+        # name, position, and onsite potential
+        ('A', [0, 0], onsite[0])
+    )
+
+    # Add hoppings
+    lat.add_hoppings(
+        ([1, 0], 'A', 'A', - 1),
+        ([0, 1], 'A', 'A', - 1)
+    )
+
+    return lat
+
+
+# load a square lattice
+lattice = square_lattice([0])
+# number of decomposition parts in each direction of matrix. This divides the lattice into various sections,
+# each of which is calculated in parallel
+nx = ny = 2
+# number of unit cells in each direction.
+lx = 256
+ly = 256
+configuration = kite.Configuration(divisions=[nx, ny], length=[lx, ly], boundaries=[True, True],
+                                   is_complex=False, precision=1, spectrum_range=[-4.1,4.1])
+
+calculation_ldos = kite.Calculation(configuration)
+calculation_ldos.ldos(energy=np.linspace(-1, 1, 100), num_moments=128, num_disorder=1, position=[64,64], sublattice='A')
+kite.config_system(lattice, configuration, calculation_ldos, filename='config.h5')
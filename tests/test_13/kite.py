@@ -0,0 +1 @@
+../../kite.py
\ No newline at end of file